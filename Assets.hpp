@@ -16,6 +16,8 @@ public:
 	Mix_Music* GetMusic(std::string path);
 	Mix_Chunk* GetSFX(std::string path);
 
+	TTF_Font* GetFont(std::string path, int size);
+
 private:
 
 	Assets();
@@ -28,7 +30,5 @@ private:
 	std::map<std::string, TTF_Font*> fonts;
 	std::map<std::string, Mix_Music*> music;
 	std::map<std::string, Mix_Chunk*> SFX;
-
-	TTF_Font* GetFont(std::string path, int size);
 };
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "Audio.hpp"
 
 Audio* Audio::instance = nullptr;
@@ -6,15 +7,27 @@ Audio::Audio()
 {
 	assets = Assets::GetInstance();
 
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 4096) < 0)
+	mixerOpen = false;
+	bufferSize = DEFAULT_BUFFER;
+	voiceLimit = IMPACT_VOICES / 2;
+
+	for (auto& slot : impacts)
 	{
-		printf("SDL Mix could not initialize! Mix_Error: %s\n", Mix_GetError());
+		slot.count = 0;
+		slot.peak = 0;
 	}
+
+	OpenMixer(bufferSize);
 }
 
 Audio::~Audio()
 {
 	assets = nullptr;
+
+	if (mixerOpen)
+	{
+		Mix_CloseAudio();
+	}
 	Mix_Quit();
 }
 
@@ -34,6 +47,45 @@ void Audio::Release()
 	instance = nullptr;
 }
 
+bool Audio::OpenMixer(int buffer)
+{
+	if (mixerOpen)
+	{
+		Mix_CloseAudio();
+		mixerOpen = false;
+	}
+
+	if (Mix_OpenAudio(FREQUENCY, MIX_DEFAULT_FORMAT, 2, buffer) < 0)
+	{
+		printf("SDL Mix could not initialize! Mix_Error: %s\n", Mix_GetError());
+		return false;
+	}
+
+	// Channel 0 stays free for PlaySFX(path), the rest form the impact voice pool
+	Mix_AllocateChannels(IMPACT_VOICES + 1);
+	Mix_GroupChannels(1, IMPACT_VOICES, IMPACT_GROUP);
+
+	mixerOpen = true;
+	bufferSize = buffer;
+	return true;
+}
+
+void Audio::SetLowLatency(bool enable, int buffer)
+{
+	int target = enable ? buffer : DEFAULT_BUFFER;
+
+	if (target != bufferSize || !mixerOpen)
+	{
+		// Decoded chunks keep the same frequency and format, so they survive the reopen
+		OpenMixer(target);
+	}
+}
+
+int Audio::BufferSize()
+{
+	return bufferSize;
+}
+
 void Audio::PlayMusic(std::string path, int loops)
 {
 	Mix_PlayMusic(assets->GetMusic(path), loops);
@@ -58,4 +110,95 @@ void Audio::ResumeMusic()
 void Audio::PlaySFX(std::string path, int loops, int channel)
 {
 	Mix_PlayChannel(channel, assets->GetSFX(path), loops);
-}
\ No newline at end of file
+}
+
+SFXHandle Audio::LoadSFX(std::string path)
+{
+	if (chunks.size() >= MAX_SFX)
+	{
+		printf("SFX table full, could not load %s\n", path.c_str());
+		return INVALID_SFX;
+	}
+
+	// Assets owns the chunk, we only keep the decoded pointer
+	chunks.push_back(assets->GetSFX(path));
+	return static_cast<SFXHandle>(chunks.size() - 1);
+}
+
+void Audio::PlaySFX(SFXHandle sfx, int loops, int channel)
+{
+	if (sfx < 0 || sfx >= static_cast<int>(chunks.size()) || chunks[sfx] == nullptr)
+		return;
+
+	Mix_PlayChannel(channel, chunks[sfx], loops);
+}
+
+void Audio::QueueImpact(SFXHandle sfx, float intensity)
+{
+	if (sfx < 0 || sfx >= MAX_SFX)
+		return;
+
+	unsigned int level = static_cast<unsigned int>(std::min(std::max(intensity, 0.0f), 1.0f) * 65535.0f);
+
+	ImpactSlot& slot = impacts[sfx];
+	slot.count.fetch_add(1, std::memory_order_relaxed);
+
+	unsigned int current = slot.peak.load(std::memory_order_relaxed);
+	while (level > current && !slot.peak.compare_exchange_weak(current, level, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Audio::SetVoiceLimit(int voices)
+{
+	voiceLimit = std::min(std::max(voices, 0), IMPACT_VOICES);
+}
+
+void Audio::FlushImpacts()
+{
+	struct Pending
+	{
+		SFXHandle sfx;
+		unsigned int count;
+		unsigned int peak;
+	};
+
+	Pending pending[MAX_SFX];
+	int nPending = 0;
+
+	// Drain every slot even if the mixer is closed, so stale impacts never pile up
+	for (int i = 0; i < static_cast<int>(chunks.size()); i++)
+	{
+		unsigned int count = impacts[i].count.exchange(0, std::memory_order_relaxed);
+		unsigned int peak = impacts[i].peak.exchange(0, std::memory_order_relaxed);
+
+		if (count > 0 && chunks[i] != nullptr)
+		{
+			pending[nPending++] = { i, count, peak };
+		}
+	}
+
+	if (!mixerOpen || nPending == 0)
+		return;
+
+	// Loudest impacts win when there are more sounds than voices
+	std::sort(pending, pending + nPending,
+		[](const Pending& a, const Pending& b) { return a.peak > b.peak; });
+
+	int voices = std::min(nPending, voiceLimit);
+
+	for (int i = 0; i < voices; i++)
+	{
+		int channel = Mix_GroupAvailable(IMPACT_GROUP);
+		if (channel < 0)
+		{
+			channel = Mix_GroupOldest(IMPACT_GROUP);
+			Mix_HaltChannel(channel);
+		}
+
+		// A pile-up of contacts plays as one slightly louder voice
+		float loudness = (pending[i].peak / 65535.0f) * (1.0f + 0.1f * std::min(pending[i].count - 1u, 5u));
+		Mix_Volume(channel, static_cast<int>(std::min(loudness, 1.0f) * MIX_MAX_VOLUME));
+		Mix_PlayChannel(channel, chunks[pending[i].sfx], 0);
+	}
+}
@@ -1,27 +1,70 @@
 #pragma once
+#include <atomic>
+#include <vector>
 #include "Assets.hpp"
 
+// Index into the pre-decoded SFX table, avoids the string lookup in Assets on every play
+using SFXHandle = int;
+const SFXHandle INVALID_SFX = -1;
+
 class Audio
 {
 public:
 
+	static const int FREQUENCY = 44100;
+	static const int DEFAULT_BUFFER = 4096;
+	static const int LOW_LATENCY_BUFFER = 256;
+
+	static const int MAX_SFX = 64;
+	static const int IMPACT_VOICES = 16;
+	static const int IMPACT_GROUP = 1;
+
 	static Audio* GetInstance();
 	static void Release();
 
+	// Reopen the mixer with a small buffer (256 samples is ~6ms at 44.1kHz)
+	void SetLowLatency(bool enable, int bufferSize = LOW_LATENCY_BUFFER);
+	int BufferSize();
+
 	void PlayMusic(std::string path, int loops = -1);
 	void PauseMusic();
 	void ResumeMusic();
 
 	void PlaySFX(std::string path, int loops = 0, int channel = 0);
 
+	SFXHandle LoadSFX(std::string path);
+	void PlaySFX(SFXHandle sfx, int loops = 0, int channel = -1);
+
+	// Safe to call from any thread, impacts are coalesced per handle until FlushImpacts
+	void QueueImpact(SFXHandle sfx, float intensity);
+
+	// Call once per frame from the main thread, starts at most voiceLimit voices
+	void FlushImpacts();
+	void SetVoiceLimit(int voices);
+
 private:
 
+	struct ImpactSlot
+	{
+		std::atomic<unsigned int> count;
+		std::atomic<unsigned int> peak;
+	};
+
 	static Audio* instance;
 
 	Audio();
 	~Audio();
-	
+
+	bool OpenMixer(int buffer);
+
 	Assets* assets;
 
+	bool mixerOpen;
+	int bufferSize;
+	int voiceLimit;
+
+	std::vector<Mix_Chunk*> chunks;
+	ImpactSlot impacts[MAX_SFX];
+
 };
 
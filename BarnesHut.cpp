@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include "BarnesHut.hpp"
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+	const size_t MIN_CHUNK = 256;
+}
+
+void BarnesHut::Build(const Vector2D* positions, const float* masses, size_t count)
+{
+	PROFILE_ZONE("BarnesHut::Build");
+
+	nodes.clear();
+	order.resize(count);
+	sortedPositions.resize(count);
+	sortedMasses.resize(count);
+
+	if (count == 0)
+		return;
+
+	BoundingBox bounds = { positions[0], positions[0] };
+	for (size_t i = 0; i < count; i++)
+	{
+		order[i] = static_cast<int>(i);
+		bounds.min.x = std::min(bounds.min.x, positions[i].x);
+		bounds.min.y = std::min(bounds.min.y, positions[i].y);
+		bounds.max.x = std::max(bounds.max.x, positions[i].x);
+		bounds.max.y = std::max(bounds.max.y, positions[i].y);
+	}
+
+	// Positions are needed in tree order while partitioning, the original index rides along
+	for (size_t i = 0; i < count; i++)
+	{
+		sortedPositions[i] = positions[i];
+		sortedMasses[i] = masses[i];
+	}
+
+	Vector2D extent = bounds.max - bounds.min;
+	Node root;
+	root.centre = bounds.Centre();
+	root.halfSize = 0.5f * std::max(std::max(extent.x, extent.y), 1.0f);
+	root.first = 0;
+	root.count = static_cast<int>(count);
+	root.firstChild = -1;
+	nodes.reserve(count / 2 + 1);
+	nodes.push_back(root);
+
+	Subdivide(0, 0);
+}
+
+int BarnesHut::Partition(int first, int last, bool alongX, float split)
+{
+	// Bodies below the split move to the front, returns the first one above it
+	while (first < last)
+	{
+		const Vector2D& p = sortedPositions[first];
+		if ((alongX ? p.x : p.y) < split)
+		{
+			first++;
+		}
+		else
+		{
+			last--;
+			std::swap(sortedPositions[first], sortedPositions[last]);
+			std::swap(sortedMasses[first], sortedMasses[last]);
+			std::swap(order[first], order[last]);
+		}
+	}
+	return first;
+}
+
+void BarnesHut::Subdivide(int index, int depth)
+{
+	// Copied out, pushing children may reallocate the array
+	Node node = nodes[index];
+
+	if (node.count <= LEAF_SIZE || depth >= MAX_DEPTH)
+	{
+		float mass = 0.0f;
+		Vector2D moment;
+		for (int i = node.first; i < node.first + node.count; i++)
+		{
+			mass += sortedMasses[i];
+			moment += sortedMasses[i] * sortedPositions[i];
+		}
+
+		nodes[index].mass = mass;
+		nodes[index].centreOfMass = mass > 0.0f ? moment / mass : node.centre;
+		return;
+	}
+
+	// Split into top and bottom, then each half into left and right
+	int end = node.first + node.count;
+	int middle = Partition(node.first, end, false, node.centre.y);
+	int splits[5] = { node.first, Partition(node.first, middle, true, node.centre.x), middle,
+		Partition(middle, end, true, node.centre.x), end };
+
+	int firstChild = static_cast<int>(nodes.size());
+	nodes[index].firstChild = firstChild;
+
+	float quarter = 0.5f * node.halfSize;
+	for (int c = 0; c < 4; c++)
+	{
+		Node child;
+		child.centre = node.centre + Vector2D((c & 1) ? quarter : -quarter, (c & 2) ? quarter : -quarter);
+		child.halfSize = quarter;
+		child.first = splits[c];
+		child.count = splits[c + 1] - splits[c];
+		child.firstChild = -1;
+		child.mass = 0.0f;
+		child.centreOfMass = child.centre;
+		nodes.push_back(child);
+	}
+
+	float mass = 0.0f;
+	Vector2D moment;
+	for (int c = 0; c < 4; c++)
+	{
+		if (nodes[firstChild + c].count > 0)
+			Subdivide(firstChild + c, depth + 1);
+
+		mass += nodes[firstChild + c].mass;
+		moment += nodes[firstChild + c].mass * nodes[firstChild + c].centreOfMass;
+	}
+
+	nodes[index].mass = mass;
+	nodes[index].centreOfMass = mass > 0.0f ? moment / mass : node.centre;
+}
+
+Vector2D BarnesHut::Acceleration(const Vector2D& p) const
+{
+	return Evaluate(p, -1);
+}
+
+Vector2D BarnesHut::Evaluate(const Vector2D& p, int skip) const
+{
+	Vector2D acceleration;
+	if (nodes.empty())
+		return acceleration;
+
+	float thetaSquared = theta * theta;
+	float softeningSquared = softening * softening;
+
+	// Depth first, at most three siblings wait per level
+	int stack[3 * MAX_DEPTH + 4];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node& node = nodes[stack[--top]];
+		if (node.count == 0)
+			continue;
+
+		Vector2D d = node.centreOfMass - p;
+		float distanceSquared = d.NormSquared();
+		float size = 2.0f * node.halfSize;
+
+		// Never approximate a cell the point is inside, it would pull on itself
+		bool inside = std::abs(p.x - node.centre.x) <= node.halfSize && std::abs(p.y - node.centre.y) <= node.halfSize;
+
+		if (node.firstChild < 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				if (i == skip)
+					continue;
+
+				Vector2D r = sortedPositions[i] - p;
+				float s = r.NormSquared() + softeningSquared;
+				acceleration += (sortedMasses[i] / (s * sqrtf(s))) * r;
+			}
+		}
+		else if (!inside && size * size < thetaSquared * distanceSquared)
+		{
+			float s = distanceSquared + softeningSquared;
+			acceleration += (node.mass / (s * sqrtf(s))) * d;
+		}
+		else
+		{
+			for (int c = 3; c >= 0; c--)
+				stack[top++] = node.firstChild + c;
+		}
+	}
+
+	return gravitationalConstant * acceleration;
+}
+
+void BarnesHut::Accelerations(Vector2D* out) const
+{
+	PROFILE_ZONE("BarnesHut::Accelerations");
+
+	// Walked in tree order so neighbouring bodies share the cached part of the tree,
+	// every body is written by exactly one chunk so the result does not depend on threads
+	ThreadPool::GetInstance()->ParallelFor(order.size(), MIN_CHUNK, [&](size_t /*chunk*/, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				out[order[i]] = Evaluate(sortedPositions[i], static_cast<int>(i));
+			}
+		});
+}
+
+size_t BarnesHut::NodeCount() const
+{
+	return nodes.size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include "Vector2D.hpp"
+#include "BoundingBox.hpp"
+
+// Barnes-Hut quadtree for pairwise attraction. Each node keeps the total mass and centre of
+// mass of the bodies below it, and a node that looks small enough from a body stands in for
+// all of them, so a force evaluation is O(log n) instead of O(n).
+class BarnesHut
+{
+public:
+
+	// Bodies per leaf, and a depth cap so coincident bodies cannot recurse forever
+	static const int LEAF_SIZE = 8;
+	static const int MAX_DEPTH = 24;
+
+	// A node of width s at distance d is used whole when s < theta * d, 0 gives the exact sum
+	float theta = 0.5f;
+
+	float gravitationalConstant = 1000.0f;
+
+	// Plummer softening length, keeps the force finite when bodies overlap
+	float softening = 4.0f;
+
+	void Build(const Vector2D* positions, const float* masses, size_t count);
+
+	// Acceleration of every body given to the last Build, evaluated in parallel
+	void Accelerations(Vector2D* out) const;
+
+	// Acceleration at an arbitrary point due to every body
+	Vector2D Acceleration(const Vector2D& p) const;
+
+	size_t NodeCount() const;
+
+private:
+
+	struct Node
+	{
+		// Square cell
+		Vector2D centre;
+		float halfSize;
+
+		Vector2D centreOfMass;
+		float mass;
+
+		// Bodies are order[first] to order[first + count - 1], children are firstChild to firstChild + 3
+		int first;
+		int count;
+		int firstChild;
+	};
+
+	// skip is a position in tree order whose body is left out, -1 for none
+	Vector2D Evaluate(const Vector2D& p, int skip) const;
+
+	void Subdivide(int node, int depth);
+	int Partition(int first, int last, bool alongX, float split);
+
+	std::vector<Node> nodes;
+
+	// Body indices sorted so every node covers a contiguous range, with positions and masses in that order
+	std::vector<int> order;
+	std::vector<Vector2D> sortedPositions;
+	std::vector<float> sortedMasses;
+
+};
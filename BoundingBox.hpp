@@ -0,0 +1,47 @@
+#pragma once
+#include "Vector2D.hpp"
+
+// Axis aligned bounds used by the broadphase and spatial queries
+struct BoundingBox
+{
+	Vector2D min;
+	Vector2D max;
+
+	BoundingBox()
+	{}
+
+	BoundingBox(Vector2D minIn, Vector2D maxIn)
+	{
+		min = minIn;
+		max = maxIn;
+	}
+
+	bool Overlaps(const BoundingBox& b) const
+	{
+		return min.x <= b.max.x && b.min.x <= max.x && min.y <= b.max.y && b.min.y <= max.y;
+	}
+
+	bool Contains(const Vector2D& p) const
+	{
+		return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y;
+	}
+
+	BoundingBox Expanded(float margin) const
+	{
+		return BoundingBox(Vector2D(min.x - margin, min.y - margin), Vector2D(max.x + margin, max.y + margin));
+	}
+
+	// Covers the box at every point of a translation by motion
+	BoundingBox Swept(const Vector2D& motion) const
+	{
+		BoundingBox b = *this;
+		(motion.x < 0.0f ? b.min.x : b.max.x) += motion.x;
+		(motion.y < 0.0f ? b.min.y : b.max.y) += motion.y;
+		return b;
+	}
+
+	Vector2D Centre() const
+	{
+		return 0.5f * (min + max);
+	}
+};
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include "Broadphase.hpp"
+#include "ContactCache.hpp"
+#include "Profiler.hpp"
+
+void Broadphase::Update(const std::vector<BroadphaseProxy>& proxies)
+{
+	PROFILE_ZONE("Broadphase::Update");
+
+	pairs.swap(previous);
+	pairs.clear();
+	began.clear();
+	ended.clear();
+
+	auto byMinX = [&proxies](int a, int b) { return proxies[a].bounds.min.x < proxies[b].bounds.min.x; };
+
+	if (order.size() != proxies.size())
+	{
+		order.resize(proxies.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = static_cast<int>(i);
+
+		std::sort(order.begin(), order.end(), byMinX);
+	}
+
+	// Bodies barely move between frames, so last frame's order is almost sorted already
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		int p = order[i];
+		size_t j = i;
+		while (j > 0 && byMinX(p, order[j - 1]))
+		{
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = p;
+	}
+
+	SortBounds(proxies);
+
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const BroadphaseProxy& a = proxies[order[i]];
+
+		for (size_t j = i + 1; j < order.size(); j++)
+		{
+			const BroadphaseProxy& b = proxies[order[j]];
+
+			if (b.bounds.min.x > a.bounds.max.x)
+				break;
+
+			if (a.layer != b.layer || b.bounds.min.y > a.bounds.max.y || a.bounds.min.y > b.bounds.max.y)
+				continue;
+
+			if (a.id < b.id)
+				pairs.push_back({ ContactKey(a.id, b.id), order[i], order[j] });
+			else
+				pairs.push_back({ ContactKey(a.id, b.id), order[j], order[i] });
+		}
+	}
+
+	if (staticGeometry != nullptr)
+	{
+		for (int i = 0; i < static_cast<int>(proxies.size()); i++)
+		{
+			staticHits.clear();
+			staticGeometry->Query(proxies[i].bounds, staticHits);
+
+			for (int s : staticHits)
+			{
+				pairs.push_back({ ContactKey(proxies[i].id, StaticGeometry::ID_BASE + s), i, -1 - s });
+			}
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end(), [](const BroadphasePair& a, const BroadphasePair& b) { return a.key < b.key; });
+
+	// Merge the two sorted lists, keys present in only one of them changed state
+	size_t i = 0, j = 0;
+	while (i < pairs.size() || j < previous.size())
+	{
+		if (j == previous.size() || (i < pairs.size() && pairs[i].key < previous[j].key))
+		{
+			began.push_back(pairs[i++].key);
+		}
+		else if (i == pairs.size() || previous[j].key < pairs[i].key)
+		{
+			ended.push_back(previous[j++].key);
+		}
+		else
+		{
+			i++;
+			j++;
+		}
+	}
+}
+
+void Broadphase::SortBounds(const std::vector<BroadphaseProxy>& proxies)
+{
+	sortedMinX.resize(order.size());
+	sortedMinY.resize(order.size());
+	sortedMaxX.resize(order.size());
+	sortedMaxY.resize(order.size());
+	maxWidth = 0.0f;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const BoundingBox& bounds = proxies[order[i]].bounds;
+		sortedMinX[i] = bounds.min.x;
+		sortedMinY[i] = bounds.min.y;
+		sortedMaxX[i] = bounds.max.x;
+		sortedMaxY[i] = bounds.max.y;
+		maxWidth = std::max(maxWidth, bounds.max.x - bounds.min.x);
+	}
+}
+
+bool Broadphase::Restore(const std::vector<BroadphaseProxy>& proxies, const std::vector<int>& orderIn, const std::vector<BroadphasePair>& pairsIn)
+{
+	Clear();
+
+	int count = static_cast<int>(orderIn.size());
+	std::vector<bool> seen(orderIn.size(), false);
+	for (int p : orderIn)
+	{
+		if (p < 0 || p >= count || seen[p])
+			return false;
+		seen[p] = true;
+	}
+
+	int statics = staticGeometry != nullptr ? staticGeometry->Count() : 0;
+	for (size_t i = 0; i < pairsIn.size(); i++)
+	{
+		const BroadphasePair& pair = pairsIn[i];
+		if ((i > 0 && pairsIn[i - 1].key >= pair.key) || pair.proxyA < 0 || pair.proxyA >= count || pair.proxyB >= count
+			|| (pair.IsStatic() && pair.StaticIndex() >= statics))
+			return false;
+	}
+
+	order = orderIn;
+	pairs = pairsIn;
+
+	if (proxies.size() == order.size())
+		SortBounds(proxies);
+
+	return true;
+}
+
+void Broadphase::SetStaticGeometry(const StaticGeometry* geometry)
+{
+	staticGeometry = geometry;
+}
+
+void Broadphase::Query(const std::vector<BroadphaseProxy>& proxies, const BoundingBox& box, std::vector<int>& out) const
+{
+	if (sortedMinX.size() != proxies.size())
+		return;
+
+	// Nothing starting left of this can reach the box
+	size_t first = std::lower_bound(sortedMinX.begin(), sortedMinX.end(), box.min.x - maxWidth) - sortedMinX.begin();
+
+	for (size_t i = first; i < sortedMinX.size() && sortedMinX[i] <= box.max.x; i++)
+	{
+		if (proxies[order[i]].bounds.Overlaps(box))
+			out.push_back(order[i]);
+	}
+}
+
+void Broadphase::Clear()
+{
+	sortedMinX.clear();
+	sortedMinY.clear();
+	sortedMaxX.clear();
+	sortedMaxY.clear();
+	maxWidth = 0.0f;
+	order.clear();
+	pairs.clear();
+	previous.clear();
+	began.clear();
+	ended.clear();
+}
+
+const std::vector<BroadphasePair>& Broadphase::Pairs() const
+{
+	return pairs;
+}
+
+const std::vector<int>& Broadphase::Order() const
+{
+	return order;
+}
+
+const std::vector<uint64_t>& Broadphase::Began() const
+{
+	return began;
+}
+
+const std::vector<uint64_t>& Broadphase::Ended() const
+{
+	return ended;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "BoundingBox.hpp"
+#include "Ray.hpp"
+#include "StaticGeometry.hpp"
+
+struct BroadphaseProxy
+{
+	BoundingBox bounds;
+	uint32_t id;
+
+	// Only proxies sharing a layer are paired
+	int layer;
+};
+
+// Proxy indices refer to the array passed to the last Update, proxyA always has the smaller id.
+// A negative proxyB is static collider -1 - proxyB.
+struct BroadphasePair
+{
+	uint64_t key;
+	int proxyA;
+	int proxyB;
+
+	bool IsStatic() const
+	{
+		return proxyB < 0;
+	}
+
+	int StaticIndex() const
+	{
+		return -1 - proxyB;
+	}
+};
+
+// Sort and sweep along x. Overlapping pairs are kept sorted by key so consecutive frames
+// can be diffed into begin/end events without touching pairs that did not change.
+class Broadphase
+{
+public:
+
+	// Proxies are also paired with static colliders on every layer, nullptr disables that
+	void SetStaticGeometry(const StaticGeometry* geometry);
+
+	void Update(const std::vector<BroadphaseProxy>& proxies);
+	void Clear();
+
+	const std::vector<BroadphasePair>& Pairs() const;
+
+	// Sort order of the proxies, the next Update starts its insertion sort from it
+	const std::vector<int>& Order() const;
+
+	// Puts back the order and pairs of an earlier Update, so the next one sorts and diffs the same
+	// way. Queries see the proxies only when there is one per entry of the order, pass none to
+	// leave them empty until the next Update. False, with the broadphase cleared, when the order
+	// is not a permutation or the pairs are unsorted or out of range.
+	bool Restore(const std::vector<BroadphaseProxy>& proxies, const std::vector<int>& order, const std::vector<BroadphasePair>& pairs);
+
+	// Keys of pairs that started or stopped overlapping in the last Update
+	const std::vector<uint64_t>& Began() const;
+	const std::vector<uint64_t>& Ended() const;
+
+	// Appends the indices of proxies overlapping the box, using the order from the last Update.
+	// Pass the same array that was given to Update.
+	void Query(const std::vector<BroadphaseProxy>& proxies, const BoundingBox& box, std::vector<int>& out) const;
+
+	// Walks the proxies whose bounds the ray enters, nearest end of the sweep first, eight bounds
+	// per slab test. hit(proxy, nearest) returns the distance of an exact hit, or nearest on a miss,
+	// and later proxies are pruned against the nearest hit so far. Returns the nearest distance.
+	template <typename F> float Raycast(const Ray& ray, F hit) const;
+
+private:
+
+	static const int RAY_LANES = 8;
+
+	void SortBounds(const std::vector<BroadphaseProxy>& proxies);
+
+	const StaticGeometry* staticGeometry = nullptr;
+	std::vector<int> staticHits;
+
+	std::vector<int> order;
+
+	// min.x of order[i], and the widest proxy, so queries can binary search their start
+	std::vector<float> sortedMinX;
+
+	// The rest of the bounds in the same order, so ray tests read them as lanes
+	std::vector<float> sortedMinY;
+	std::vector<float> sortedMaxX;
+	std::vector<float> sortedMaxY;
+	float maxWidth = 0.0f;
+	std::vector<BroadphasePair> pairs;
+	std::vector<BroadphasePair> previous;
+
+	std::vector<uint64_t> began;
+	std::vector<uint64_t> ended;
+
+};
+
+template <typename F> float Broadphase::Raycast(const Ray& ray, F hit) const
+{
+	float nearest = ray.length;
+	size_t count = sortedMinX.size();
+	if (count == 0)
+		return nearest;
+
+	// A huge inverse instead of infinity, so a zero direction never produces 0 * inf
+	const float LARGE = 1.0e30f;
+	float invX = ray.direction.x != 0.0f ? 1.0f / ray.direction.x : LARGE;
+	float invY = ray.direction.y != 0.0f ? 1.0f / ray.direction.y : LARGE;
+
+	bool forward = ray.direction.x >= 0.0f;
+
+	// Sweep from the origin's end, so hits shrink the remaining range early
+	float reach = ray.origin.x + ray.length * ray.direction.x;
+	size_t begin = std::lower_bound(sortedMinX.begin(), sortedMinX.end(), std::min(ray.origin.x, reach) - maxWidth) - sortedMinX.begin();
+	size_t end = std::upper_bound(sortedMinX.begin(), sortedMinX.end(), std::max(ray.origin.x, reach)) - sortedMinX.begin();
+
+	size_t processed = 0;
+	size_t total = end > begin ? end - begin : 0;
+
+	while (processed < total)
+	{
+		int lanes = static_cast<int>(std::min<size_t>(RAY_LANES, total - processed));
+		size_t first = forward ? begin + processed : end - processed - lanes;
+
+		float tEnter[RAY_LANES];
+		float tExit[RAY_LANES];
+
+		// Fixed width loop the compiler turns into packed min/max
+		for (int k = 0; k < RAY_LANES; k++)
+		{
+			size_t i = first + (k < lanes ? k : 0);
+			float x0 = (sortedMinX[i] - ray.origin.x) * invX;
+			float x1 = (sortedMaxX[i] - ray.origin.x) * invX;
+			float y0 = (sortedMinY[i] - ray.origin.y) * invY;
+			float y1 = (sortedMaxY[i] - ray.origin.y) * invY;
+
+			float xNear = x0 < x1 ? x0 : x1;
+			float xFar = x0 < x1 ? x1 : x0;
+			float yNear = y0 < y1 ? y0 : y1;
+			float yFar = y0 < y1 ? y1 : y0;
+
+			tEnter[k] = xNear > yNear ? xNear : yNear;
+			tExit[k] = xFar < yFar ? xFar : yFar;
+		}
+
+		for (int j = 0; j < lanes; j++)
+		{
+			int k = forward ? j : lanes - 1 - j;
+			if (tExit[k] >= 0.0f && tEnter[k] <= tExit[k] && tEnter[k] <= nearest)
+				nearest = std::min(nearest, hit(order[first + k], nearest));
+		}
+
+		processed += lanes;
+
+		// Everything left starts beyond the nearest hit along x
+		float limit = ray.origin.x + nearest * ray.direction.x;
+		if (processed < total)
+		{
+			if (forward && sortedMinX[begin + processed] > limit)
+				break;
+			if (!forward && sortedMinX[end - processed - 1] + maxWidth < limit)
+				break;
+		}
+	}
+
+	return nearest;
+}
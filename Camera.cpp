@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cmath>
+#include "Camera.hpp"
+
+Camera::Camera()
+{
+	viewport = { 0, 0, Graphics::SCREEN_WIDTH, Graphics::SCREEN_HEIGHT };
+	Reset();
+}
+
+void Camera::SetViewport(SDL_Rect view)
+{
+	viewport = view;
+}
+
+const SDL_Rect& Camera::Viewport() const
+{
+	return viewport;
+}
+
+void Camera::Reset()
+{
+	position = VEC_ZERO;
+	zoom = 1.0f;
+}
+
+void Camera::Update(Input* input, float dt)
+{
+	Vector2D pan;
+
+	if (input->KeyDown(SDL_SCANCODE_LEFT)) pan.x -= 1.0f;
+	if (input->KeyDown(SDL_SCANCODE_RIGHT)) pan.x += 1.0f;
+	if (input->KeyDown(SDL_SCANCODE_UP)) pan.y -= 1.0f;
+	if (input->KeyDown(SDL_SCANCODE_DOWN)) pan.y += 1.0f;
+
+	Pan(PAN_SPEED * dt * pan);
+
+	Vector2D mouse = input->MousePosition();
+	if (input->MouseButtonDown(Input::middle))
+	{
+		Pan(lastMouse - mouse);
+	}
+	lastMouse = mouse;
+
+	Vector2D centre(viewport.x + 0.5f * viewport.w, viewport.y + 0.5f * viewport.h);
+
+	if (input->KeyDown(SDL_SCANCODE_EQUALS) || input->KeyDown(SDL_SCANCODE_KP_PLUS))
+	{
+		ZoomAt(std::pow(ZOOM_RATE, dt), centre);
+	}
+
+	if (input->KeyDown(SDL_SCANCODE_MINUS) || input->KeyDown(SDL_SCANCODE_KP_MINUS))
+	{
+		ZoomAt(std::pow(ZOOM_RATE, -dt), centre);
+	}
+
+	if (input->HotkeyPressed(SDL_SCANCODE_HOME))
+	{
+		Reset();
+	}
+}
+
+void Camera::Pan(Vector2D screenDelta)
+{
+	position += screenDelta / zoom;
+}
+
+void Camera::ZoomAt(float factor, Vector2D screenPoint)
+{
+	// Keep the world point under screenPoint fixed
+	Vector2D anchor = ScreenToWorld(screenPoint);
+	zoom = std::min(std::max(zoom * factor, MIN_ZOOM), MAX_ZOOM);
+	position = anchor - (screenPoint - Vector2D(viewport.x, viewport.y)) / zoom;
+}
+
+Vector2D Camera::WorldToScreen(Vector2D p) const
+{
+	return zoom * (p - position) + Vector2D(viewport.x, viewport.y);
+}
+
+Vector2D Camera::ScreenToWorld(Vector2D p) const
+{
+	return (p - Vector2D(viewport.x, viewport.y)) / zoom + position;
+}
+
+BoundingBox Camera::VisibleBounds() const
+{
+	return BoundingBox(position, position + Vector2D(viewport.w / zoom, viewport.h / zoom));
+}
+
+void Camera::Apply(Graphics* graphics) const
+{
+	graphics->SetView(position - Vector2D(viewport.x, viewport.y) / zoom, zoom);
+}
+
+float Camera::Zoom() const
+{
+	return zoom;
+}
+
+Vector2D Camera::Position() const
+{
+	return position;
+}
+
+void Camera::SetView(Vector2D p, float z)
+{
+	position = p;
+	zoom = std::min(std::max(z, MIN_ZOOM), MAX_ZOOM);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <SDL.h>
+#include "Vector2D.hpp"
+#include "BoundingBox.hpp"
+#include "Graphics.hpp"
+#include "Input.hpp"
+
+// Maps the world onto a screen viewport. Arrow keys or a middle mouse drag pan,
+// +/- zoom about the centre of the viewport and Home resets.
+class Camera
+{
+public:
+
+	const float MIN_ZOOM = 0.05f;
+	const float MAX_ZOOM = 8.0f;
+
+	// Screen pixels per second, and zoom factor per second while a key is held
+	const float PAN_SPEED = 600.0f;
+	const float ZOOM_RATE = 2.0f;
+
+	Camera();
+
+	void SetViewport(SDL_Rect viewport);
+	const SDL_Rect& Viewport() const;
+
+	void Reset();
+
+	// Once per rendered frame with the wall-clock frame time, before Input::UpdateHotkeys
+	void Update(Input* input, float dt);
+
+	void Pan(Vector2D screenDelta);
+	void ZoomAt(float factor, Vector2D screenPoint);
+
+	Vector2D WorldToScreen(Vector2D p) const;
+	Vector2D ScreenToWorld(Vector2D p) const;
+
+	// World space region covered by the viewport
+	BoundingBox VisibleBounds() const;
+
+	// Routes the Graphics draw calls through this camera until Graphics::ResetView
+	void Apply(Graphics* graphics) const;
+
+	float Zoom() const;
+	Vector2D Position() const;
+
+	// Restores a view saved with Position and Zoom
+	void SetView(Vector2D position, float zoom);
+
+private:
+
+	SDL_Rect viewport;
+
+	// World position shown at the top left of the viewport
+	Vector2D position;
+	float zoom;
+
+	Vector2D lastMouse;
+
+};
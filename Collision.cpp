@@ -132,7 +132,7 @@ bool Collision::ResolveSAT_Static(Polygon& p1, Polygon& p2)
 
 		for (int a = 0; a < poly1->Size(); a++)
 		{
-			Vector2D axisProj = (poly1->vertices[a + 1] - poly1->vertices[a]).Orth();
+			Vector2D axisProj = (poly1->Vertex(a + 1) - poly1->Vertex(a)).Orth();
 			axisProj.Normalise();
 
 			// Work out min and max 1D points for p1
@@ -167,9 +167,355 @@ bool Collision::ResolveSAT_Static(Polygon& p1, Polygon& p2)
 	float s = d.Norm();
 	poly1->centre -= 0.5f * overlap * d / s;
 	poly2->centre += 0.5f * overlap * d / s;
-	return false;
+	return true;
+}
+
+bool Collision::DiskContact(const Disk& dA, const Disk& dB, Manifold& manifold)
+{
+	Vector2D separation = dB.centre - dA.centre;
+	float radii = dA.radius + dB.radius;
+	float distanceSquared = separation.NormSquared();
+
+	if (distanceSquared > radii * radii)
+		return false;
+
+	float distance = std::sqrt(distanceSquared);
+
+	// Coincident centres have no preferred direction, push apart vertically
+	manifold.normal = distance > 0.0f ? separation / distance : VEC_DOWN;
+	manifold.depth = radii - distance;
+	manifold.point = dA.centre + (dA.radius - 0.5f * manifold.depth) * manifold.normal;
+	return true;
+}
+
+bool Collision::RectContact(const Rect& rectA, const Rect& rectB, Manifold& manifold)
+{
+	float overlapX = std::min(rectA.x + rectA.w, rectB.x + rectB.w) - std::max(rectA.x, rectB.x);
+	float overlapY = std::min(rectA.y + rectA.h, rectB.y + rectB.h) - std::max(rectA.y, rectB.y);
+
+	if (overlapX <= 0.0f || overlapY <= 0.0f)
+		return false;
+
+	Vector2D d = rectB.Centre() - rectA.Centre();
+
+	// Separate along the axis of least penetration
+	if (overlapX < overlapY)
+	{
+		manifold.normal = d.x < 0.0f ? VEC_LEFT : VEC_RIGHT;
+		manifold.depth = overlapX;
+	}
+	else
+	{
+		manifold.normal = d.y < 0.0f ? VEC_UP : VEC_DOWN;
+		manifold.depth = overlapY;
+	}
+
+	manifold.point = Vector2D(std::max(rectA.x, rectB.x) + 0.5f * overlapX, std::max(rectA.y, rectB.y) + 0.5f * overlapY);
+	return true;
+}
+
+bool Collision::PolygonContact(const Polygon& pA, const Polygon& pB, Manifold& manifold)
+{
+	const Polygon* poly1 = &pA;
+	const Polygon* poly2 = &pB;
+
+	float overlap = INFINITY;
+	Vector2D axis;
+
+	for (int shape = 0; shape < 2; shape++)
+	{
+		if (shape == 1)
+		{
+			poly1 = &pB;
+			poly2 = &pA;
+		}
+
+		for (int a = 0; a < poly1->Size(); a++)
+		{
+			Vector2D axisProj = (poly1->Vertex(a + 1) - poly1->Vertex(a)).Orth();
+			axisProj.Normalise();
+
+			float min_p1 = INFINITY, max_p1 = -INFINITY;
+			for (int p = 0; p < poly1->Size(); p++)
+			{
+				float q = (poly1->centre + poly1->Vertex(p)).Dot(axisProj);
+				min_p1 = std::min(min_p1, q);
+				max_p1 = std::max(max_p1, q);
+			}
+
+			float min_p2 = INFINITY, max_p2 = -INFINITY;
+			for (int p = 0; p < poly2->Size(); p++)
+			{
+				float q = (poly2->centre + poly2->Vertex(p)).Dot(axisProj);
+				min_p2 = std::min(min_p2, q);
+				max_p2 = std::max(max_p2, q);
+			}
+
+			// Distance needed to push the projections apart, also right when one contains
+			// the other or has no extent at all (segments)
+			float o = std::min(max_p1 - min_p2, max_p2 - min_p1);
+			if (o <= 0.0f)
+				return false;
+
+			if (o < overlap)
+			{
+				overlap = o;
+				axis = axisProj;
+			}
+		}
+	}
+
+	// Orient the axis of least penetration from A to B
+	if (axis.Dot(pB.centre - pA.centre) < 0.0f)
+		axis = -axis;
+
+	// Deepest vertex of B along the normal approximates the contact point
+	Vector2D support = pB.centre + pB.Vertex(0);
+	for (int p = 1; p < pB.Size(); p++)
+	{
+		Vector2D v = pB.centre + pB.Vertex(p);
+		if (v.Dot(axis) < support.Dot(axis))
+			support = v;
+	}
+
+	manifold.normal = axis;
+	manifold.depth = overlap;
+	manifold.point = support;
+	return true;
+}
+
+bool Collision::DiskPolygonContact(const Disk& d, const Polygon& p, Manifold& manifold)
+{
+	int n = p.Size();
+	Vector2D c = d.centre - p.centre;
+
+	// Closest point on the outline, and whether the centre lies inside every edge
+	float closestSquared = INFINITY;
+	Vector2D closest;
+	bool inside = n >= 3;
+	float shallowest = INFINITY;
+	Vector2D shallowestNormal;
+
+	for (int i = 0; i < n; i++)
+	{
+		Vector2D a = p.Vertex(i);
+		Vector2D edge = p.Vertex(i + 1) - a;
+		float lengthSquared = edge.NormSquared();
+
+		float t = lengthSquared > 0.0f ? std::min(std::max((c - a).Dot(edge) / lengthSquared, 0.0f), 1.0f) : 0.0f;
+		Vector2D q = a + t * edge;
+		float distanceSquared = (c - q).NormSquared();
+
+		if (distanceSquared < closestSquared)
+		{
+			closestSquared = distanceSquared;
+			closest = q;
+		}
+
+		if (n >= 3)
+		{
+			// Outward edge normal, whatever the winding
+			Vector2D normal = edge.Orth().Normalised();
+			if (normal.Dot(a) < 0.0f)
+				normal = -normal;
+
+			float separation = (c - a).Dot(normal);
+			if (separation > 0.0f)
+			{
+				inside = false;
+			}
+			else if (-separation < shallowest)
+			{
+				shallowest = -separation;
+				shallowestNormal = normal;
+			}
+		}
+	}
+
+	if (inside)
+	{
+		// Push out through the nearest edge
+		manifold.normal = -shallowestNormal;
+		manifold.depth = d.radius + shallowest;
+		manifold.point = d.centre + shallowest * shallowestNormal;
+		return true;
+	}
+
+	if (closestSquared > d.radius * d.radius)
+		return false;
+
+	float distance = std::sqrt(closestSquared);
+	Vector2D toClosest = closest - c;
+
+	manifold.normal = distance > 0.0f ? toClosest / distance : VEC_DOWN;
+	manifold.depth = d.radius - distance;
+	manifold.point = p.centre + closest;
+	return true;
 }
 
+bool Collision::RectPolygonContact(const Rect& rect, const Polygon& p, Manifold& manifold)
+{
+	Vector2D half(0.5f * rect.w, 0.5f * rect.h);
+	Polygon box(rect.Centre(), { Vector2D(-half.x, -half.y), Vector2D(half.x, -half.y),
+		Vector2D(half.x, half.y), Vector2D(-half.x, half.y) });
+
+	return PolygonContact(box, p, manifold);
+}
+
+bool Collision::RayBox(const Ray& ray, const BoundingBox& box, float& distance, Vector2D& normal)
+{
+	if (box.Contains(ray.origin))
+	{
+		distance = 0.0f;
+		normal = -ray.direction;
+		return true;
+	}
+
+	// Slabs, a zero direction component only passes if the origin is between the planes
+	float tEnter = 0.0f;
+	float tExit = ray.length;
+	Vector2D enterNormal;
+
+	const float origin[2] = { ray.origin.x, ray.origin.y };
+	const float direction[2] = { ray.direction.x, ray.direction.y };
+	const float lower[2] = { box.min.x, box.min.y };
+	const float upper[2] = { box.max.x, box.max.y };
+
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (direction[axis] == 0.0f)
+		{
+			if (origin[axis] < lower[axis] || origin[axis] > upper[axis])
+				return false;
+			continue;
+		}
+
+		float inv = 1.0f / direction[axis];
+		float t0 = (lower[axis] - origin[axis]) * inv;
+		float t1 = (upper[axis] - origin[axis]) * inv;
+		float side = -1.0f;
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+			side = 1.0f;
+		}
+
+		if (t0 > tEnter)
+		{
+			tEnter = t0;
+			enterNormal = axis == 0 ? Vector2D(side, 0.0f) : Vector2D(0.0f, side);
+		}
+		tExit = std::min(tExit, t1);
+
+		if (tEnter > tExit)
+			return false;
+	}
+
+	distance = tEnter;
+	normal = enterNormal;
+	return true;
+}
+
+bool Collision::RayDisk(const Ray& ray, const Disk& d, float& distance, Vector2D& normal)
+{
+	Vector2D m = ray.origin - d.centre;
+	float c = m.NormSquared() - d.radius * d.radius;
+
+	if (c <= 0.0f)
+	{
+		distance = 0.0f;
+		normal = -ray.direction;
+		return true;
+	}
+
+	// |m + t dir|^2 = r^2 with a unit direction
+	float b = m.Dot(ray.direction);
+	float discriminant = b * b - c;
+	if (b > 0.0f || discriminant < 0.0f)
+		return false;
+
+	float t = -b - std::sqrt(discriminant);
+	if (t > ray.length)
+		return false;
+
+	distance = t;
+	normal = (ray.At(t) - d.centre) / d.radius;
+	return true;
+}
+
+bool Collision::RayPolygon(const Ray& ray, const Polygon& p, float& distance, Vector2D& normal)
+{
+	int n = p.Size();
+	Vector2D origin = ray.origin - p.centre;
+
+	if (n == 2)
+	{
+		// Segment, solve origin + t dir = a + s edge
+		Vector2D a = p.Vertex(0);
+		Vector2D edge = p.Vertex(1) - a;
+		float denominator = ray.direction.Cross(edge);
+		if (denominator == 0.0f)
+			return false;
+
+		Vector2D offset = a - origin;
+		float t = offset.Cross(edge) / denominator;
+		float s = offset.Cross(ray.direction) / denominator;
+		if (t < 0.0f || t > ray.length || s < 0.0f || s > 1.0f)
+			return false;
+
+		Vector2D edgeNormal = edge.Orth().Normalised();
+		distance = t;
+		normal = edgeNormal.Dot(ray.direction) > 0.0f ? -edgeNormal : edgeNormal;
+		return true;
+	}
+
+	if (n < 3)
+		return false;
+
+	// Cyrus-Beck clipping against every edge's outward half plane
+	float tEnter = 0.0f;
+	float tExit = ray.length;
+	Vector2D enterNormal = -ray.direction;
+
+	for (int i = 0; i < n; i++)
+	{
+		Vector2D a = p.Vertex(i);
+		Vector2D edgeNormal = (p.Vertex(i + 1) - a).Orth().Normalised();
+		if (edgeNormal.Dot(a) < 0.0f)
+			edgeNormal = -edgeNormal;
+
+		float separation = (origin - a).Dot(edgeNormal);
+		float approach = ray.direction.Dot(edgeNormal);
+
+		if (approach == 0.0f)
+		{
+			if (separation > 0.0f)
+				return false;
+			continue;
+		}
+
+		float t = -separation / approach;
+		if (approach < 0.0f)
+		{
+			if (t > tEnter)
+			{
+				tEnter = t;
+				enterNormal = edgeNormal;
+			}
+		}
+		else
+		{
+			tExit = std::min(tExit, t);
+		}
+
+		if (tEnter > tExit)
+			return false;
+	}
+
+	distance = tEnter;
+	normal = enterNormal;
+	return true;
+}
 
 // TODO: try implementing the following
 /*---------------------------------------------------------------------------
@@ -319,4 +665,81 @@ in a post to this list a couple of years ago.  No one seemed to notice
 or appreciate it except Dave Eberly. You can find code implementing it
 on his web site, www.magic-software.com.
 
----------------------------------------------------------------------------*/
\ No newline at end of file
+---------------------------------------------------------------------------*/
+
+bool Collision::SweptDisk(const Disk& d, const Vector2D& motion, const Disk& target, float& t, Vector2D& normal)
+{
+	float length = motion.Norm();
+	float radius = d.radius + target.radius;
+	if (length == 0.0f || (d.centre - target.centre).NormSquared() < radius * radius)
+		return false;
+
+	// The centre against the target grown by the moving radius
+	float distance;
+	if (!RayDisk(Ray(d.centre, motion, length), Disk(radius, target.centre.x, target.centre.y), distance, normal))
+		return false;
+
+	t = distance / length;
+	return true;
+}
+
+bool Collision::SweptDiskPolygon(const Disk& d, const Vector2D& motion, const Polygon& p, float& t, Vector2D& normal)
+{
+	int n = p.Size();
+	float length = motion.Norm();
+	Manifold manifold;
+	if (n < 2 || length == 0.0f || DiskPolygonContact(d, p, manifold))
+		return false;
+
+	// The centre against the polygon grown by the radius, edges pushed out along their normals
+	// and a disk at every vertex
+	Ray ray(d.centre, motion, length);
+	Vector2D origin = d.centre - p.centre;
+	float nearest = length;
+	bool hit = false;
+
+	int edges = n == 2 ? 1 : n;
+	for (int i = 0; i < edges; i++)
+	{
+		Vector2D a = p.Vertex(i);
+		Vector2D edge = p.Vertex(i + 1) - a;
+		Vector2D edgeNormal = edge.Orth().Normalised();
+
+		// Outward for polygons, towards the disk for segments
+		if (n == 2 ? edgeNormal.Dot(origin - a) < 0.0f : edgeNormal.Dot(a) < 0.0f)
+			edgeNormal = -edgeNormal;
+
+		float approach = ray.direction.Dot(edgeNormal);
+		if (approach >= 0.0f)
+			continue;
+
+		float distance = (a + d.radius * edgeNormal - origin).Dot(edgeNormal) / approach;
+		if (distance < 0.0f || distance > nearest)
+			continue;
+
+		float s = (origin + distance * ray.direction - a).Dot(edge) / edge.NormSquared();
+		if (s < 0.0f || s > 1.0f)
+			continue;
+
+		nearest = distance;
+		normal = edgeNormal;
+		hit = true;
+	}
+
+	for (int i = 0; i < n; i++)
+	{
+		Vector2D v = p.centre + p.Vertex(i);
+		float distance;
+		Vector2D vertexNormal;
+		if (RayDisk(ray, Disk(d.radius, v.x, v.y), distance, vertexNormal) && distance < nearest)
+		{
+			nearest = distance;
+			normal = vertexNormal;
+			hit = true;
+		}
+	}
+
+	if (hit)
+		t = nearest / length;
+	return hit;
+}
@@ -3,6 +3,15 @@
 #include "Disk.h"
 #include "Rect.hpp"
 #include "Polygon.hpp"
+#include "Ray.hpp"
+
+// Overlap between two shapes, the normal points from the first shape towards the second
+struct Manifold
+{
+	Vector2D normal;
+	Vector2D point;
+	float depth;
+};
 
 class Collision
 {
@@ -32,4 +41,23 @@ public:
 
 	static bool ResolveSAT_Static(Polygon& p1, Polygon& p2);
 
+	// Contact generation for the solver, these only report and never move the shapes
+	static bool DiskContact(const Disk& dA, const Disk& dB, Manifold& manifold);
+	static bool RectContact(const Rect& rectA, const Rect& rectB, Manifold& manifold);
+	static bool PolygonContact(const Polygon& pA, const Polygon& pB, Manifold& manifold);
+
+	// Convex polygon with two or more vertices, two vertex polygons act as segments
+	static bool DiskPolygonContact(const Disk& d, const Polygon& p, Manifold& manifold);
+	static bool RectPolygonContact(const Rect& rect, const Polygon& p, Manifold& manifold);
+
+	// Ray casts for scene queries, distance is along the ray and only hits within its length count
+	static bool RayBox(const Ray& ray, const BoundingBox& box, float& distance, Vector2D& normal);
+	static bool RayDisk(const Ray& ray, const Disk& d, float& distance, Vector2D& normal);
+	static bool RayPolygon(const Ray& ray, const Polygon& p, float& distance, Vector2D& normal);
+
+	// Time of impact of a disk translating by motion, t is the fraction of motion covered and the normal
+	// points back at the moving disk. Shapes overlapping at the start are left to the contact tests.
+	static bool SweptDisk(const Disk& d, const Vector2D& motion, const Disk& target, float& t, Vector2D& normal);
+	static bool SweptDiskPolygon(const Disk& d, const Vector2D& motion, const Polygon& p, float& t, Vector2D& normal);
+
 };
\ No newline at end of file
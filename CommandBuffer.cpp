@@ -0,0 +1,173 @@
+#include "CommandBuffer.hpp"
+#include "Profiler.hpp"
+
+CommandBuffer::CommandBuffer()
+{
+	spawned = 0;
+	block = 0;
+	used = 0;
+}
+
+CommandBuffer::~CommandBuffer()
+{
+	Clear();
+}
+
+CommandBuffer::CommandBuffer(CommandBuffer&& b) noexcept
+	: commands(std::move(b.commands)), blocks(std::move(b.blocks))
+{
+	spawned = b.spawned;
+	block = b.block;
+	used = b.used;
+
+	b.commands.clear();
+	b.spawned = 0;
+	b.block = 0;
+	b.used = 0;
+}
+
+CommandBuffer::Target CommandBuffer::Existing(EntityHandle handle)
+{
+	return { handle, NOT_SPAWNED };
+}
+
+CommandBuffer::Target CommandBuffer::spawn()
+{
+	Target t = { EntityHandle(), spawned++ };
+	commands.push_back({ spawnCommand, t, 0, nullptr, nullptr, nullptr });
+	return t;
+}
+
+void CommandBuffer::destroy(Target target)
+{
+	commands.push_back({ destroyCommand, target, 0, nullptr, nullptr, nullptr });
+}
+
+void CommandBuffer::addGroup(Target target, Group mGroup)
+{
+	commands.push_back({ addGroupCommand, target, mGroup, nullptr, nullptr, nullptr });
+}
+
+void CommandBuffer::delGroup(Target target, Group mGroup)
+{
+	commands.push_back({ delGroupCommand, target, mGroup, nullptr, nullptr, nullptr });
+}
+
+void* CommandBuffer::Allocate(size_t size, size_t alignment)
+{
+	while (true)
+	{
+		if (block < blocks.size())
+		{
+			size_t offset = (used + alignment - 1) & ~(alignment - 1);
+			if (offset + size <= BLOCK_SIZE)
+			{
+				used = offset + size;
+				return blocks[block].get() + offset;
+			}
+
+			block++;
+			used = 0;
+			continue;
+		}
+
+		blocks.emplace_back(new char[BLOCK_SIZE]);
+	}
+}
+
+void CommandBuffer::Apply(ECSManager& manager)
+{
+	spawnedEntities.clear();
+
+	for (const Command& c : commands)
+	{
+		if (c.type == spawnCommand)
+		{
+			spawnedEntities.push_back(&manager.addEntity());
+			continue;
+		}
+
+		Entity* e = c.target.spawn == NOT_SPAWNED ? manager.get(c.target.handle) : spawnedEntities[c.target.spawn];
+		if (e == nullptr || !e->isActive())
+			continue;
+
+		switch (c.type)
+		{
+		case destroyCommand:
+			e->destroy();
+			break;
+		case componentCommand:
+			c.apply(c.payload, *e);
+			break;
+		case addGroupCommand:
+			e->addGroup(c.group);
+			break;
+		case delGroupCommand:
+			e->delGroup(c.group);
+			break;
+		default:
+			break;
+		}
+	}
+
+	Clear();
+}
+
+void CommandBuffer::Clear()
+{
+	for (const Command& c : commands)
+	{
+		if (c.release != nullptr)
+			c.release(c.payload);
+	}
+
+	commands.clear();
+	spawned = 0;
+	block = 0;
+	used = 0;
+}
+
+bool CommandBuffer::Empty() const
+{
+	return commands.empty();
+}
+
+void CommandBuffers::Prepare(size_t count)
+{
+	while (buffers.size() < count)
+		buffers.emplace_back();
+}
+
+CommandBuffer& CommandBuffers::operator[](size_t chunk)
+{
+	return buffers[chunk];
+}
+
+void CommandBuffers::Apply(ECSManager& manager)
+{
+	PROFILE_ZONE("CommandBuffers::Apply");
+
+	for (auto& b : buffers)
+	{
+		if (!b.Empty())
+			b.Apply(manager);
+	}
+}
+
+
+void CommandBuffers::Clear()
+{
+	for (auto& b : buffers)
+		b.Clear();
+}
+
+bool CommandBuffers::Empty() const
+{
+	for (const auto& b : buffers)
+	{
+		if (!b.Empty())
+			return false;
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "ECS.hpp"
+
+// Structural changes recorded during a parallel phase and applied at a sync point. Each
+// buffer belongs to one writer, so recording takes no locks, and nothing touches the
+// ECSManager until Apply.
+class CommandBuffer
+{
+public:
+
+	// An existing entity, or one spawned earlier in the same buffer
+	struct Target
+	{
+		EntityHandle handle;
+		uint32_t spawn;
+	};
+
+	static const uint32_t NOT_SPAWNED = ~0u;
+
+	CommandBuffer();
+	~CommandBuffer();
+
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
+	CommandBuffer(CommandBuffer&& b) noexcept;
+
+	static Target Existing(EntityHandle handle);
+
+	// The entity is created at Apply, the target refers to it for later commands in this buffer
+	Target spawn();
+	void destroy(Target target);
+
+	// Arguments are copied now and forwarded to addComponent at Apply
+	template <typename T, typename... TArgs> void addComponent(Target target, TArgs&&... mArgs);
+
+	void addGroup(Target target, Group mGroup);
+	void delGroup(Target target, Group mGroup);
+
+	// Runs the commands in recording order and empties the buffer, commands on destroyed entities are dropped
+	void Apply(ECSManager& manager);
+	void Clear();
+
+	bool Empty() const;
+
+private:
+
+	enum TYPE : uint8_t { spawnCommand, destroyCommand, componentCommand, addGroupCommand, delGroupCommand };
+
+	struct Command
+	{
+		TYPE type;
+		Target target;
+		Group group;
+
+		// Component arguments live in the arena
+		void* payload;
+		void (*apply)(void* payload, Entity& entity);
+		void (*release)(void* payload);
+	};
+
+	// Payloads are placed in fixed blocks that never move, blocks are kept for reuse after Apply
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	void* Allocate(size_t size, size_t alignment);
+
+	template <typename T, typename Tuple, std::size_t... I> static void AddComponent(Entity& entity, Tuple& args, std::index_sequence<I...>);
+
+	std::vector<Command> commands;
+	uint32_t spawned;
+
+	std::vector<std::unique_ptr<char[]>> blocks;
+	size_t block;
+	size_t used;
+
+	std::vector<Entity*> spawnedEntities;
+
+};
+
+template <typename T, typename Tuple, std::size_t... I>
+void CommandBuffer::AddComponent(Entity& entity, Tuple& args, std::index_sequence<I...>)
+{
+	entity.addComponent<T>(std::move(std::get<I>(args))...);
+}
+
+template <typename T, typename... TArgs> void CommandBuffer::addComponent(Target target, TArgs&&... mArgs)
+{
+	using Args = std::tuple<typename std::decay<TArgs>::type...>;
+	static_assert(sizeof(Args) <= BLOCK_SIZE, "component arguments too large for a command");
+
+	void* payload = new (Allocate(sizeof(Args), alignof(Args))) Args(std::forward<TArgs>(mArgs)...);
+
+	Command c;
+	c.type = componentCommand;
+	c.target = target;
+	c.group = 0;
+	c.payload = payload;
+	c.apply = [](void* p, Entity& e)
+		{
+			AddComponent<T>(e, *static_cast<Args*>(p), std::index_sequence_for<TArgs...>());
+		};
+	c.release = [](void* p)
+		{
+			static_cast<Args*>(p)->~Args();
+		};
+	commands.push_back(c);
+}
+
+// One buffer per ParallelFor chunk. Chunk boundaries only depend on the item and thread
+// counts, so applying the buffers in chunk order is deterministic for a fixed thread count.
+class CommandBuffers
+{
+public:
+
+	// Makes at least count buffers available, call it before the phase that records into them
+	void Prepare(size_t count);
+
+	CommandBuffer& operator[](size_t chunk);
+
+	// Applies every buffer in index order
+	void Apply(ECSManager& manager);
+	void Clear();
+
+	bool Empty() const;
+
+private:
+
+	std::vector<CommandBuffer> buffers;
+
+};
@@ -0,0 +1,124 @@
+#include "ContactCache.hpp"
+
+const uint64_t ContactCache::EMPTY;
+
+ContactCache::ContactCache()
+{
+	count = 0;
+	Clear();
+}
+
+size_t ContactCache::Home(uint64_t key) const
+{
+	// Fibonacci hashing spreads the sequential ids over the whole table
+	return static_cast<size_t>((key * 0x9e3779b97f4a7c15ULL) >> 32) & (slots.size() - 1);
+}
+
+ContactManifold* ContactCache::Find(uint64_t key)
+{
+	size_t mask = slots.size() - 1;
+
+	for (size_t i = Home(key); ; i = (i + 1) & mask)
+	{
+		if (slots[i].key == key)
+			return &slots[i];
+
+		if (slots[i].key == EMPTY)
+			return nullptr;
+	}
+}
+
+ContactManifold& ContactCache::Insert(uint64_t key)
+{
+	// Keep the load factor under one half so probe runs stay short
+	if (2 * (count + 1) > slots.size())
+	{
+		Grow();
+	}
+
+	size_t mask = slots.size() - 1;
+	size_t i = Home(key);
+
+	while (slots[i].key != EMPTY)
+	{
+		if (slots[i].key == key)
+			return slots[i];
+
+		i = (i + 1) & mask;
+	}
+
+	ContactManifold& m = slots[i];
+	m = ContactManifold();
+	m.key = key;
+	m.depth = 0.0f;
+	m.normalImpulse = 0.0f;
+	m.tangentImpulse = 0.0f;
+	m.age = 0;
+	m.touching = false;
+
+	count++;
+	return m;
+}
+
+bool ContactCache::Remove(uint64_t key)
+{
+	ContactManifold* m = Find(key);
+	if (m == nullptr)
+		return false;
+
+	size_t mask = slots.size() - 1;
+	size_t hole = static_cast<size_t>(m - slots.data());
+
+	// Backward shift deletion, no tombstones so lookups never degrade over time
+	for (size_t i = (hole + 1) & mask; slots[i].key != EMPTY; i = (i + 1) & mask)
+	{
+		size_t home = Home(slots[i].key);
+
+		// Move the entry back if the hole lies between its home slot and where it sits now
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			slots[hole] = slots[i];
+			hole = i;
+		}
+	}
+
+	slots[hole].key = EMPTY;
+	count--;
+	return true;
+}
+
+void ContactCache::Clear()
+{
+	ContactManifold empty = ContactManifold();
+	empty.key = EMPTY;
+	slots.assign(MIN_CAPACITY, empty);
+	count = 0;
+}
+
+size_t ContactCache::Size() const
+{
+	return count;
+}
+
+void ContactCache::Grow()
+{
+	std::vector<ContactManifold> old;
+	old.swap(slots);
+
+	ContactManifold empty = ContactManifold();
+	empty.key = EMPTY;
+	slots.assign(old.size() * 2, empty);
+
+	size_t mask = slots.size() - 1;
+	for (auto& m : old)
+	{
+		if (m.key == EMPTY)
+			continue;
+
+		size_t i = Home(m.key);
+		while (slots[i].key != EMPTY)
+			i = (i + 1) & mask;
+
+		slots[i] = m;
+	}
+}
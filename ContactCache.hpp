@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Vector2D.hpp"
+
+// Order independent key for a pair of entity ids
+inline uint64_t ContactKey(uint32_t a, uint32_t b)
+{
+	return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+inline uint32_t ContactKeyFirst(uint64_t key)
+{
+	return static_cast<uint32_t>(key >> 32);
+}
+
+inline uint32_t ContactKeySecond(uint64_t key)
+{
+	return static_cast<uint32_t>(key);
+}
+
+// Everything remembered about a pair while its bounds overlap
+struct ContactManifold
+{
+	uint64_t key;
+
+	Vector2D normal;
+	Vector2D point;
+	float depth;
+
+	float normalImpulse;
+	float tangentImpulse;
+
+	// Frames the shapes have been touching, only meaningful while touching is set
+	unsigned int age;
+	bool touching;
+};
+
+struct ContactEvent
+{
+	enum TYPE { begin = 0, persist, end };
+
+	TYPE type;
+	uint64_t key;
+	Vector2D point;
+	Vector2D normal;
+
+	// Relative normal speed when the contact was solved, zero for end events
+	float approachSpeed;
+};
+
+// Open addressing table with linear probing, entries are inserted and removed
+// from broadphase begin/end events rather than rebuilt every frame.
+class ContactCache
+{
+public:
+
+	ContactCache();
+
+	ContactManifold* Find(uint64_t key);
+
+	// Returns the existing entry, or a new one that is not touching yet
+	ContactManifold& Insert(uint64_t key);
+
+	bool Remove(uint64_t key);
+	void Clear();
+
+	size_t Size() const;
+
+	template <typename F> void ForEach(F f)
+	{
+		for (auto& slot : slots)
+		{
+			if (slot.key != EMPTY)
+				f(slot);
+		}
+	}
+
+private:
+
+	// Ids are never both 0xffffffff, so the all ones key cannot occur
+	static const uint64_t EMPTY = ~0ULL;
+	static const size_t MIN_CAPACITY = 64;
+
+	size_t Home(uint64_t key) const;
+	void Grow();
+
+	std::vector<ContactManifold> slots;
+	size_t count;
+
+};
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cmath>
+#include "ContactSolver.hpp"
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+	const size_t MIN_CHUNK = 64;
+
+	// Static bodies are shared by many contacts of a colour, so they are never written
+	void ApplyImpulse(SolverBody& a, SolverBody& b, const Vector2D& P)
+	{
+		if (a.invMass > 0.0f)
+			a.velocity -= a.invMass * P;
+		if (b.invMass > 0.0f)
+			b.velocity += b.invMass * P;
+	}
+
+	void ApplyPseudoImpulse(SolverBody& a, SolverBody& b, const Vector2D& P)
+	{
+		if (a.invMass > 0.0f)
+			a.pseudoVelocity -= a.invMass * P;
+		if (b.invMass > 0.0f)
+			b.pseudoVelocity += b.invMass * P;
+	}
+}
+
+void ContactSolver::Solve(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts, float dt)
+{
+	PROFILE_ZONE("ContactSolver::Solve");
+
+	for (auto& b : bodies)
+	{
+		b.pseudoVelocity.Zero();
+	}
+
+	coloured = contacts.size() >= parallelThreshold;
+	if (coloured)
+	{
+		Colour(bodies, contacts);
+	}
+
+	PreStep(bodies, contacts);
+
+	for (int i = 0; i < velocityIterations; i++)
+	{
+		SolveVelocities(bodies, contacts);
+	}
+
+	if (dt > 0.0f)
+	{
+		for (int i = 0; i < positionIterations; i++)
+		{
+			SolvePositions(bodies, contacts, dt);
+		}
+	}
+}
+
+int ContactSolver::ColourCount() const
+{
+	return coloured ? static_cast<int>(colourStart.size()) - 2 : 0;
+}
+
+void ContactSolver::Colour(const std::vector<SolverBody>& bodies, const std::vector<Contact>& contacts)
+{
+	PROFILE_ZONE("ContactSolver::Colour");
+
+	bodyColours.assign(bodies.size(), 0);
+	contactColours.resize(contacts.size());
+
+	// Greedy in contact order, each contact takes the lowest colour free on both of its moving bodies
+	int colours = 0;
+	for (size_t i = 0; i < contacts.size(); i++)
+	{
+		const Contact& c = contacts[i];
+		bool movingA = bodies[c.bodyA].invMass > 0.0f;
+		bool movingB = bodies[c.bodyB].invMass > 0.0f;
+
+		uint64_t used = (movingA ? bodyColours[c.bodyA] : 0) | (movingB ? bodyColours[c.bodyB] : 0);
+
+		int colour = 0;
+		while (colour < MAX_COLOURS && (used & (1ULL << colour)))
+			colour++;
+
+		contactColours[i] = colour;
+		if (colour == MAX_COLOURS)
+			continue;
+
+		colours = std::max(colours, colour + 1);
+		if (movingA)
+			bodyColours[c.bodyA] |= 1ULL << colour;
+		if (movingB)
+			bodyColours[c.bodyB] |= 1ULL << colour;
+	}
+
+	// Counting sort by colour, the overflow batch goes last
+	colourStart.assign(colours + 2, 0);
+	for (int colour : contactColours)
+		colourStart[std::min(colour, colours) + 1]++;
+
+	for (size_t k = 1; k < colourStart.size(); k++)
+		colourStart[k] += colourStart[k - 1];
+
+	colourOrder.resize(contacts.size());
+	colourNext.assign(colourStart.begin(), colourStart.end() - 1);
+	for (size_t i = 0; i < contacts.size(); i++)
+		colourOrder[colourNext[std::min(contactColours[i], colours)]++] = static_cast<int>(i);
+}
+
+template <typename F> void ContactSolver::ForEachContact(size_t count, F f)
+{
+	if (!coloured)
+	{
+		for (size_t i = 0; i < count; i++)
+			f(i);
+		return;
+	}
+
+	ThreadPool* pool = ThreadPool::GetInstance();
+	int colours = static_cast<int>(colourStart.size()) - 2;
+
+	for (int k = 0; k < colours; k++)
+	{
+		const int* batch = colourOrder.data() + colourStart[k];
+		pool->ParallelFor(colourStart[k + 1] - colourStart[k], MIN_CHUNK, [&](size_t /*chunk*/, size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+					f(static_cast<size_t>(batch[i]));
+			});
+	}
+
+	for (int i = colourStart[colours]; i < colourStart[colours + 1]; i++)
+		f(static_cast<size_t>(colourOrder[i]));
+}
+
+void ContactSolver::PreStep(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts)
+{
+	for (auto& c : contacts)
+	{
+		SolverBody& a = bodies[c.bodyA];
+		SolverBody& b = bodies[c.bodyB];
+
+		float k = a.invMass + b.invMass;
+		c.normalMass = k > 0.0f ? 1.0f / k : 0.0f;
+
+		c.restitution = std::max(a.restitution, b.restitution);
+		c.friction = std::sqrt(a.friction * b.friction);
+
+		c.approachSpeed = (b.velocity - a.velocity).Dot(c.normal);
+		c.velocityBias = c.approachSpeed < -restitutionThreshold ? -c.restitution * c.approachSpeed : 0.0f;
+
+		c.pseudoImpulse = 0.0f;
+
+		if (!warmStarting)
+		{
+			c.normalImpulse = 0.0f;
+			c.tangentImpulse = 0.0f;
+		}
+	}
+
+	// Bounce targets above must see the unmodified velocities, so warm start in a second pass
+	ForEachContact(contacts.size(), [&](size_t i)
+		{
+			Contact& c = contacts[i];
+			Vector2D P = c.normalImpulse * c.normal + c.tangentImpulse * c.normal.Orth();
+			ApplyImpulse(bodies[c.bodyA], bodies[c.bodyB], P);
+		});
+}
+
+void ContactSolver::SolveVelocities(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts)
+{
+	ForEachContact(contacts.size(), [&](size_t i)
+		{
+			Contact& c = contacts[i];
+			SolverBody& a = bodies[c.bodyA];
+			SolverBody& b = bodies[c.bodyB];
+			Vector2D tangent = c.normal.Orth();
+
+			// Friction first, bounded by the current normal impulse
+			float vt = (b.velocity - a.velocity).Dot(tangent);
+			float maxFriction = c.friction * c.normalImpulse;
+			float oldTangent = c.tangentImpulse;
+			c.tangentImpulse = std::min(std::max(oldTangent - c.normalMass * vt, -maxFriction), maxFriction);
+
+			ApplyImpulse(a, b, (c.tangentImpulse - oldTangent) * tangent);
+
+			// Normal impulse, the accumulated total may only push
+			float vn = (b.velocity - a.velocity).Dot(c.normal);
+			float oldNormal = c.normalImpulse;
+			c.normalImpulse = std::max(oldNormal - c.normalMass * (vn - c.velocityBias), 0.0f);
+
+			ApplyImpulse(a, b, (c.normalImpulse - oldNormal) * c.normal);
+		});
+}
+
+void ContactSolver::SolvePositions(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts, float dt)
+{
+	ForEachContact(contacts.size(), [&](size_t i)
+		{
+			Contact& c = contacts[i];
+			SolverBody& a = bodies[c.bodyA];
+			SolverBody& b = bodies[c.bodyB];
+
+			float target = correction * std::max(c.depth - slop, 0.0f) / dt;
+			float vn = (b.pseudoVelocity - a.pseudoVelocity).Dot(c.normal);
+
+			float oldImpulse = c.pseudoImpulse;
+			c.pseudoImpulse = std::max(oldImpulse - c.normalMass * (vn - target), 0.0f);
+
+			ApplyPseudoImpulse(a, b, (c.pseudoImpulse - oldImpulse) * c.normal);
+		});
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Vector2D.hpp"
+
+// Velocity state the solver works on, gathered from the transform components each step.
+// Bodies only translate, so a contact is fully described by its normal and inverse masses.
+struct SolverBody
+{
+	Vector2D velocity;
+
+	// Split impulse velocity, only used to push bodies apart and never fed back into velocity
+	Vector2D pseudoVelocity;
+
+	float invMass;
+	float restitution;
+	float friction;
+};
+
+struct Contact
+{
+	// Indices into the body array, normal points from A to B
+	int bodyA;
+	int bodyB;
+
+	// Identifies the pair in the contact cache
+	uint64_t key;
+
+	Vector2D normal;
+	Vector2D point;
+	float depth;
+
+	float restitution;
+	float friction;
+
+	// Relative normal speed before solving, negative when approaching
+	float approachSpeed;
+
+	// Accumulated impulses, set to last frame's values before solving to warm start
+	float normalImpulse;
+	float tangentImpulse;
+	float pseudoImpulse;
+
+	float normalMass;
+	float velocityBias;
+};
+
+// Sequential impulse solver: accumulated impulses are clamped per contact and carried over
+// to the next frame through the contact cache, so resting stacks settle in a few iterations.
+class ContactSolver
+{
+public:
+
+	int velocityIterations = 8;
+	int positionIterations = 3;
+
+	// Fraction of the penetration removed per step, and the overlap left alone to keep contacts alive
+	float correction = 0.2f;
+	float slop = 0.5f;
+
+	// Approach speed below which contacts do not bounce, so resting bodies stay at rest
+	float restitutionThreshold = 30.0f;
+
+	bool warmStarting = true;
+
+	// From this many contacts they are greedily coloured so no two contacts of a colour share a
+	// moving body, and each colour is solved in parallel. The colouring only depends on the
+	// contact order, so results are the same for any thread count.
+	size_t parallelThreshold = 1024;
+
+	// Contacts must already have bodies, normal, depth and starting impulses set
+	void Solve(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts, float dt);
+
+	// Colours used by the last Solve, 0 when it ran sequentially
+	int ColourCount() const;
+
+private:
+
+	// Colours beyond this go into one batch that is solved sequentially
+	static const int MAX_COLOURS = 64;
+
+	void PreStep(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts);
+	void SolveVelocities(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts);
+	void SolvePositions(std::vector<SolverBody>& bodies, std::vector<Contact>& contacts, float dt);
+
+	void Colour(const std::vector<SolverBody>& bodies, const std::vector<Contact>& contacts);
+
+	// Calls f(contact index) for every contact, colour by colour when coloured
+	template <typename F> void ForEachContact(size_t count, F f);
+
+	bool coloured = false;
+
+	// Colours taken by each body's contacts so far
+	std::vector<uint64_t> bodyColours;
+
+	// Contact indices grouped by colour, colour k is colourOrder[colourStart[k]] to colourOrder[colourStart[k + 1] - 1].
+	// The last group is the overflow batch.
+	std::vector<int> contactColours;
+	std::vector<int> colourOrder;
+	std::vector<int> colourStart;
+
+	// Next free slot of each colour while sorting
+	std::vector<int> colourNext;
+
+};
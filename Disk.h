@@ -1,5 +1,6 @@
 #pragma once
 #include "Vector2D.hpp"
+#include "BoundingBox.hpp"
 
 struct Disk
 {
@@ -24,4 +25,9 @@ struct Disk
 	{
 		return PI * radius * radius;
 	}
+
+	BoundingBox Bounds() const
+	{
+		return BoundingBox(Vector2D(centre.x - radius, centre.y - radius), Vector2D(centre.x + radius, centre.y + radius));
+	}
 };
\ No newline at end of file
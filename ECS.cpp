@@ -1,7 +1,25 @@
 #include "ECS.hpp"
 
+void Entity::destroy()
+{
+	if (active)
+	{
+		active = false;
+		manager.queueRefresh(this);
+	}
+}
+
 void Entity::addGroup(Group mGroup)
 {
 	groupBitSet[mGroup] = true;
 	manager.AddToGroup(this, mGroup);
+}
+
+void Entity::delGroup(Group mGroup)
+{
+	if (groupBitSet[mGroup])
+	{
+		groupBitSet[mGroup] = false;
+		manager.queueRefresh(this);
+	}
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <bitset>
 #include <array>
+#include <cstdint>
+#include <type_traits>
+#include "Profiler.hpp"
 
 class Component;
 class Entity;
@@ -12,27 +15,82 @@ class ECSManager;
 
 using ComponentID = std::size_t;
 using Group = std::size_t;
-
-inline ComponentID getNewComponentTypeID()
+using EntityID = uint32_t;
+
+// Every component type. IDs are positions in this list, so they are fixed at compile time and
+// the same in every build. A new component is declared here and appended to the list.
+class PolyTransformComponent;
+class DiskTransformComponent;
+class RectTransformComponent;
+class DiskSpriteComponent;
+class RectSpriteComponent;
+class UILabelComponent;
+
+template <typename... Ts> struct TypeList {};
+
+using RegisteredComponents = TypeList<
+	PolyTransformComponent,
+	DiskTransformComponent,
+	RectTransformComponent,
+	DiskSpriteComponent,
+	RectSpriteComponent,
+	UILabelComponent>;
+
+template <typename T> struct DependentFalse : std::false_type {};
+
+// Position of T in the list, reaching the empty list means T was never registered
+template <typename T, typename List> struct TypeIndex
 {
-	static ComponentID lastID = 0u;
-	return lastID++;
-}
+	static_assert(DependentFalse<T>::value, "Component type is not in RegisteredComponents");
+};
+
+template <typename T, typename... Ts> struct TypeIndex<T, TypeList<T, Ts...>>
+	: std::integral_constant<std::size_t, 0> {};
+
+template <typename T, typename U, typename... Ts> struct TypeIndex<T, TypeList<U, Ts...>>
+	: std::integral_constant<std::size_t, 1 + TypeIndex<T, TypeList<Ts...>>::value> {};
 
-template <typename T> inline ComponentID getComponentTypeID() noexcept
+template <typename List> struct TypeCount;
+
+template <typename... Ts> struct TypeCount<TypeList<Ts...>>
+	: std::integral_constant<std::size_t, sizeof...(Ts)> {};
+
+template <typename T> constexpr ComponentID getComponentTypeID() noexcept
 {
-	static_assert (std::is_base_of<Component, T>::value, "");
-	static ComponentID typeID = getNewComponentTypeID();
-	return typeID;
+	return TypeIndex<T, RegisteredComponents>::value;
 }
 
-constexpr std::size_t maxComponents = 32;
+constexpr std::size_t maxComponents = TypeCount<RegisteredComponents>::value;
 constexpr std::size_t maxGroups = 32;
 
+// Components stay separate heap objects found through each entity's array, not per-type
+// contiguous pools. Sprites keep pointers to their transforms, which a growing pool would
+// move, and every system walks a group and reaches components through its entities, so a
+// pool would not change the access order. The static ids make the lookup a fixed index.
 using ComponentArray = std::array<Component*, maxComponents>;
 using ComponentBitSet = std::bitset<maxComponents>;
 using GroupBitSet = std::bitset<maxGroups>;
 
+// Weak reference to an entity. Slots are reused with a new generation, so a handle to a
+// destroyed entity resolves to nullptr instead of to whatever took its place.
+struct EntityHandle
+{
+	static const uint32_t INVALID = ~0u;
+
+	uint32_t index = INVALID;
+	uint32_t generation = 0u;
+
+	bool operator==(const EntityHandle& h) const
+	{
+		return index == h.index && generation == h.generation;
+	}
+
+	bool operator!=(const EntityHandle& h) const
+	{
+		return !(*this == h);
+	}
+};
+
 class Component
 {
 public:
@@ -52,19 +110,39 @@ class Entity
 {
 private:
 
+	friend class ECSManager;
+
+	static const uint32_t NOT_IN_GROUP = ~0u;
+
 	ECSManager& manager;
 
+	// Handed out in increasing order and never reused while the world lives, so pairs of ids can
+	// key per-contact state across frames. A restore replaces the world and brings back the ids
+	// the snapshot was taken with, its contact state included.
+	EntityID id;
+
 	bool active = true;
 
+	// Waiting for the next refresh to leave groups or be freed
+	bool queued = false;
+
 	std::vector<std::unique_ptr<Component>> components;
 
 	ComponentArray componentArray;
 	ComponentBitSet componentBitSet;
 	GroupBitSet groupBitSet;
 
+	// Slot in the manager's handle table, position in its entity list and in each group
+	EntityHandle handle;
+	uint32_t position = 0u;
+	std::array<uint32_t, maxGroups> groupPosition;
+
 public:
 
-	Entity(ECSManager& mManager)  : manager(mManager) {}
+	Entity(ECSManager& mManager, EntityID mID) : manager(mManager), id(mID)
+	{
+		for (auto& p : groupPosition) p = NOT_IN_GROUP;
+	}
 
 	void EarlyUpdate()
 	{
@@ -86,8 +164,13 @@ public:
 		for (auto& c : components) c->draw();
 	}
 
+	EntityID getID() const { return id; }
+	EntityHandle getHandle() const { return handle; }
+
 	bool isActive() const { return active; }
-	void destroy() { active = false; }
+
+	// Takes effect at the next refresh, until then the entity stays in its groups
+	void destroy();
 
 	bool hasGroup(Group mGroup)
 	{
@@ -95,11 +178,7 @@ public:
 	}
 
 	void addGroup(Group mGroup);
-
-	void delGroup(Group mGroup)
-	{
-		groupBitSet[mGroup] = false;
-	}
+	void delGroup(Group mGroup);
 
 	template <typename T> bool hasComponent() const
 	{
@@ -109,6 +188,8 @@ public:
 	template <typename T, typename... TArgs>
 	T& addComponent(TArgs&&... mArgs)
 	{
+		static_assert(std::is_base_of<Component, T>::value, "");
+
 		T* c(new T(std::forward<TArgs>(mArgs)...));
 		c->entity = this;
 
@@ -123,9 +204,10 @@ public:
 		return *c;
 	}
 
+	// A constant index into the array, there is no lookup
 	template <typename T> T& getComponent() const
 	{
-		auto ptr(componentArray[getComponentTypeID<T>()]);
+		auto ptr(std::get<getComponentTypeID<T>()>(componentArray));
 		return *static_cast<T*>(ptr);
 	}
 };
@@ -137,6 +219,53 @@ private:
 	std::vector<std::unique_ptr<Entity>> entities;
 	std::array<std::vector<Entity*>, maxGroups> groupedEntities;
 
+	struct Slot
+	{
+		Entity* entity;
+		uint32_t generation;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+
+	// Entities destroyed or removed from a group since the last refresh
+	std::vector<Entity*> queued;
+
+	EntityID nextID = 0u;
+
+	template <typename T> static void reserveMore(std::vector<T>& v, std::size_t count)
+	{
+		if (v.capacity() < v.size() + count)
+			v.reserve(std::max(v.size() + count, 2 * v.capacity()));
+	}
+
+	// Swap and pop, the last member of the group takes the entity's place. Group order decides
+	// solver order, so it is part of the simulation state that keyframes capture and restore.
+	void removeFromGroup(Entity* mEntity, Group mGroup)
+	{
+		auto& v(groupedEntities[mGroup]);
+		uint32_t i = mEntity->groupPosition[mGroup];
+
+		v[i] = v.back();
+		v[i]->groupPosition[mGroup] = i;
+		v.pop_back();
+
+		mEntity->groupPosition[mGroup] = Entity::NOT_IN_GROUP;
+	}
+
+	void removeEntity(Entity* mEntity)
+	{
+		Slot& slot = slots[mEntity->handle.index];
+		slot.entity = nullptr;
+		slot.generation++;
+		freeSlots.push_back(mEntity->handle.index);
+
+		uint32_t i = mEntity->position;
+		std::swap(entities[i], entities.back());
+		entities[i]->position = i;
+		entities.pop_back();
+	}
+
 public:
 
 	void EarlyUpdate()
@@ -159,30 +288,57 @@ public:
 		for (auto& e : entities) e->draw();
 	}
 
+	// Only visits entities queued since the last refresh, so it costs nothing when nothing changed.
+	// Removal swaps the last entity into the gap, so group order is not creation order.
 	void refresh()
 	{
-		for (auto i(0u); i < maxGroups; i++)
+		PROFILE_ZONE("ECSManager::refresh");
+
+		for (Entity* e : queued)
 		{
-			auto& v(groupedEntities[i]);
-			v.erase(
-				std::remove_if(std::begin(v), std::end(v),
-					[i](Entity* mEntity)
-					{
-						return !mEntity->isActive() || !mEntity->hasGroup(i);
-					}), std::end(v));
-			
+			e->queued = false;
+
+			for (auto i(0u); i < maxGroups; i++)
+			{
+				if (e->groupPosition[i] != Entity::NOT_IN_GROUP && (!e->isActive() || !e->hasGroup(i)))
+					removeFromGroup(e, i);
+			}
+
+			// Frees e, so it goes last
+			if (!e->isActive())
+				removeEntity(e);
+		}
+
+		queued.clear();
+	}
+
+	void destroyAll()
+	{
+		for (auto& e : entities) e->destroy();
+	}
+
+	// Id the next addEntity hands out. A restore sets it before each spawn so bodies get back
+	// the ids they were captured with, contact state is keyed by them. Handles stay safe since
+	// they check the slot generation, which keeps counting.
+	EntityID getNextID() const { return nextID; }
+	void setNextID(EntityID id) { nextID = id; }
+
+	void queueRefresh(Entity* mEntity)
+	{
+		if (!mEntity->queued)
+		{
+			mEntity->queued = true;
+			queued.push_back(mEntity);
 		}
-		
-		entities.erase(std::remove_if(std::begin(entities), std::end(entities),
-			[](const std::unique_ptr<Entity>& mEntity)
-				{
-					return !mEntity->isActive();
-				}),
-			std::end(entities));
 	}
 
 	void AddToGroup(Entity* mEntity, Group mGroup)
 	{
+		// Still a member when removed and re-added before a refresh
+		if (mEntity->groupPosition[mGroup] != Entity::NOT_IN_GROUP)
+			return;
+
+		mEntity->groupPosition[mGroup] = static_cast<uint32_t>(groupedEntities[mGroup].size());
 		groupedEntities[mGroup].emplace_back(mEntity);
 	}
 
@@ -191,10 +347,46 @@ public:
 		return groupedEntities[mGroup];
 	}
 
+	// Room for count more entities, so bulk spawns grow the arrays once. Growth is at least
+	// doubling, so many small batches stay amortised like push_back.
+	void reserve(std::size_t count)
+	{
+		reserveMore(entities, count);
+		reserveMore(slots, count);
+	}
+
+	void reserveGroup(Group mGroup, std::size_t count)
+	{
+		reserveMore(groupedEntities[mGroup], count);
+	}
+
+	// nullptr once the entity has been destroyed
+	Entity* get(EntityHandle mHandle) const
+	{
+		if (mHandle.index >= slots.size() || slots[mHandle.index].generation != mHandle.generation)
+			return nullptr;
+
+		Entity* e = slots[mHandle.index].entity;
+		return e != nullptr && e->isActive() ? e : nullptr;
+	}
+
 	Entity& addEntity()
 	{
-		Entity* e = new Entity(*this);
+		Entity* e = new Entity(*this, nextID++);
 		std::unique_ptr<Entity> uPtr{ e };
+
+		if (freeSlots.empty())
+		{
+			freeSlots.push_back(static_cast<uint32_t>(slots.size()));
+			slots.push_back({ nullptr, 0u });
+		}
+
+		e->handle.index = freeSlots.back();
+		e->handle.generation = slots[e->handle.index].generation;
+		slots[e->handle.index].entity = e;
+		freeSlots.pop_back();
+
+		e->position = static_cast<uint32_t>(entities.size());
 		entities.emplace_back(std::move(uPtr));
 
 		return *e;
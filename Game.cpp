@@ -23,10 +23,59 @@ Game::Game()
     audio = Audio::GetInstance();
     timer = Timer::GetInstance();
     collision = Collision::GetInstance();
+    replay = Replay::GetInstance();
+    threadPool = ThreadPool::GetInstance();
+    Profiler::GetInstance();
+
+    tick = 0;
+    simulationTime = 0.0;
+    nBodyGravity = false;
+    motionAccelerations = false;
+    queryBodiesValid = false;
+    turbo = false;
+    eventDriven = false;
+    observables.perimeter = 2.0f * (Graphics::SCREEN_WIDTH + Graphics::SCREEN_HEIGHT);
+    observableTicks = 0;
+    observableTime = 0.0;
+    cameraCounter = SDL_GetPerformanceCounter();
+
+    random.Seed(DEFAULT_SEED);
+
+    // Keyframes carry the contact cache, broadphase and engine along with the bodies, so a seek
+    // carries on exactly where the recording was
+    replay->SetKeyframeWriter([this](std::vector<char>& out)
+        {
+            CaptureSnapshot(keyframeSnapshot);
+            keyframeSnapshot.Serialise(out);
+        });
+
+    audio->SetLowLatency(true);
+    impactSFX = audio->LoadSFX("assets/impact.wav");
 
+    StaticGeometry::Builder arena;
+    arena.restitution = WALL_RESTITUTION;
+    arena.friction = WALL_FRICTION;
+    arena.AddArena(Rect(0.0f, 0.0f, Graphics::SCREEN_WIDTH, Graphics::SCREEN_HEIGHT), WALL_THICKNESS);
+    SetStaticGeometry(arena.Build());
+
+    arenaBounds = BoundingBox(VEC_ZERO, Vector2D(Graphics::SCREEN_WIDTH, Graphics::SCREEN_HEIGHT));
+    arenaGeometry = true;
 }
 Game::~Game()
 {
+    Profiler::Release();
+
+    observableWriter.Close();
+
+    ThreadPool::Release();
+    threadPool = nullptr;
+
+    Replay::Release();
+    replay = nullptr;
+
+    // The overlay's labels own textures made by the renderer
+    overlay.Shutdown();
+
     Assets::Release();
     assets = nullptr;
 
@@ -61,33 +110,76 @@ void Game::Release()
 
 void Game::EarlyUpdate()
 {
+    PROFILE_ZONE("Game::EarlyUpdate");
+
+    // Sync point for everything deferred during the last tick. It comes before the replay, so a
+    // keyframe never holds commands that a seek would drop.
+    if (!commands.Empty())
+    {
+        commands.Apply(manager);
+        queryBodiesValid = false;
+        manager.refresh();
+    }
+
+    if (replay->Mode() == Replay::playing && !replay->PlaybackTick(inputFrame, random))
+    {
+        StopReplay();
+    }
+
+    // Ticks run with the view they were recorded with, however the camera moved between frames
+    if (replay->Mode() == Replay::playing)
+    {
+        camera.SetView(Vector2D(inputFrame.viewX, inputFrame.viewY), inputFrame.viewZoom);
+    }
+
     input->Update();
 
+    if (replay->Mode() == Replay::recording)
+    {
+        input->GetFrame(inputFrame);
+        inputFrame.viewX = camera.Position().x;
+        inputFrame.viewY = camera.Position().y;
+        inputFrame.viewZoom = camera.Zoom();
+        replay->RecordTick(inputFrame, random);
+    }
+
+    Vector2D mouse = camera.ScreenToWorld(input->MousePosition());
+
     if (input->MouseButtonPressed(Input::left) || (input->KeyDown(SDL_SCANCODE_LSHIFT) && input->MouseButtonDown(Input::left)))
     {
-        int n = rand() % 10 + 3;
+        int n = random.Range(3, 13);
 
-        auto& poly(manager.addEntity());
-        Polygon p(Vector2D(input->MousePosition().x, input->MousePosition().y), n, 30);
-        poly.addComponent<PolyTransformComponent>(p, 1.0f);
-        poly.addGroup(polyGroup);
+        Uint8 r = static_cast<Uint8>(random.Range(0, 255));
+        Uint8 g = static_cast<Uint8>(random.Range(0, 255));
+        Uint8 b = static_cast<Uint8>(random.Range(0, 255));
+
+        // Dragging keeps spawning, but not on top of bodies already there
+        Polygon polygon(mouse, n, 30);
+        if (input->MouseButtonPressed(Input::left))
+        {
+            SpawnPoly(polygon, 1.0f, SDL_Color{ r, g, b, 0xff });
+        }
+        else
+        {
+            QueryPolygon(polygon, spawnOverlaps);
+            if (spawnOverlaps.empty())
+                SpawnPoly(polygon, 1.0f, SDL_Color{ r, g, b, 0xff });
+        }
     }
 
     if (input->MouseButtonPressed(Input::right))
     {
-        auto& rect(manager.addEntity());
-        rect.addComponent<RectTransformComponent>(input->MousePosition().x - 20.0f, input->MousePosition().y - 20.0f, 40.0f, 40.f, 1.0f);
-        rect.addComponent<RectSpriteComponent>();
-        rect.getComponent<RectTransformComponent>().SetVelocity(Vector2D());
-        rect.addGroup(rectGroup);
+        SpawnRect(mouse - Vector2D(20.0f, 20.0f), Vector2D(40.0f, 40.0f), 1.0f);
     }
 
+    UpdateStreaming();
+
+    queryBodiesValid = false;
     manager.refresh();
-    manager.EarlyUpdate();
-}
 
-void Game::Update()
-{
+    // Switches and pushes land before the step begins, so a step never mixes schemes and the
+    // velocities gathered into the motion arrays include every push
+
     // Antigravity??
     if (input->KeyDown(SDL_SCANCODE_SPACE))
     {
@@ -101,53 +193,195 @@ void Game::Update()
             r->getComponent<RectTransformComponent>().ApplyForce(Vector2D(0.0f, -20.0f));
         }
     }
+
+    if (input->KeyPressed(SDL_SCANCODE_G))
+    {
+        SetNBodyGravity(!nBodyGravity);
+    }
+
+    if (input->KeyPressed(SDL_SCANCODE_H))
+    {
+        SetEventDriven(!eventDriven);
+    }
+
+    if (input->KeyPressed(SDL_SCANCODE_I))
+    {
+        SetIntegrator(static_cast<Integrator::SCHEME>((integrator.scheme + 1) % Integrator::SCHEME_COUNT));
+    }
+
+    // Spawning a box or switching on n-body gravity drops back to stepping
+    if (eventDriven && !EventDrivenAllowed())
+    {
+        printf("Event-driven disks stopped, back to stepping\n");
+        SetEventDriven(false);
+    }
+
+    // The engine moves disks itself
+    if (!eventDriven)
+    {
+        overlay.BeginPhase(PerfOverlay::integration);
+        IntegrateBegin();
+        manager.EarlyUpdate();
+        overlay.EndPhase(PerfOverlay::integration);
+    }
+}
+
+void Game::Update()
+{
+    PROFILE_ZONE("Game::Update");
+
+    if (eventDriven)
+    {
+        overlay.BeginPhase(PerfOverlay::collision);
+        StepHardDisks();
+        overlay.EndPhase(PerfOverlay::collision);
+        return;
+    }
+
+    overlay.BeginPhase(PerfOverlay::integration);
+    IntegrateForces();
+    overlay.EndPhase(PerfOverlay::integration);
     
+    overlay.BeginPhase(PerfOverlay::collision);
     HandleCollision();
+    overlay.EndPhase(PerfOverlay::collision);
 
+    overlay.BeginPhase(PerfOverlay::integration);
+    IntegrateEnd();
     manager.Update();
+    overlay.EndPhase(PerfOverlay::integration);
+
+    // Destroyed at the start of the next tick, until then the step's proxies stay valid
+    CullEscapedBodies();
 
 }
 
 void Game::LateUpdate()
 {
+    PROFILE_ZONE("Game::LateUpdate");
+
     manager.LateUpdate();
     
     input->UpdatePrevious();
 
-    float energy = 0;
+    audio->FlushImpacts();
+
+    if (observableWriter.IsOpen())
+    {
+        observableTime += timer->DeltaTime();
+
+        if (++observableTicks >= OBSERVABLE_INTERVAL)
+        {
+            SampleObservables();
+        }
+    }
+
+    tick++;
+    simulationTime += timer->DeltaTime();
+}
+
+void Game::CountBodies()
+{
+    counters.disks = static_cast<unsigned int>(disks.size());
+    counters.rects = static_cast<unsigned int>(rects.size());
+    counters.polys = static_cast<unsigned int>(polys.size());
+
+    float sleepSquared = overlay.SLEEP_SPEED * overlay.SLEEP_SPEED;
+    unsigned int sleeping = 0;
+
+    for (auto& d : disks)
+        if (d->getComponent<DiskTransformComponent>().GetVelocity()->NormSquared() < sleepSquared) sleeping++;
+
+    for (auto& r : rects)
+        if (r->getComponent<RectTransformComponent>().GetVelocity()->NormSquared() < sleepSquared) sleeping++;
+
+    for (auto& p : polys)
+        if (p->getComponent<PolyTransformComponent>().GetVelocity()->NormSquared() < sleepSquared) sleeping++;
+
+    counters.sleepingBodies = sleeping;
+    counters.activeBodies = counters.disks + counters.rects + counters.polys - sleeping;
+}
+
+void Game::SampleObservables()
+{
+    observableSample.tick = tick;
+    observableSample.time = simulationTime;
+    observables.gravity = integrator.gravity.y;
+    observables.floor = FloorHeight();
+    observables.Measure(disks, rects, polys, observableTime, observableSample);
+    observableWriter.Push(observableSample);
+
+    observableTicks = 0;
+    observableTime = 0.0;
+}
+
+float Game::FloorHeight()
+{
+    // Worlds with their own geometry may reach well below the window
+    if (arenaGeometry || staticGeometry.Count() == 0)
+        return arenaBounds.max.y;
 
+    return staticGeometry.Bounds().max.y;
+}
 
-    // Compute total energy
-    /*for (auto& c : colliders)
+void Game::ToggleObservableLog(std::string path)
+{
+    if (observableWriter.IsOpen())
     {
-        energy += (c->getComponent<TransformComponent>().Energy()) / 1000000.0f;
-    }*/
-    // std::cout << "Current total energy: " << energy << std::endl;
+        observableWriter.Close();
+        return;
+    }
 
+    if (observableWriter.Open(path, ObservableWriter::csv))
+    {
+        // Discard wall impulse collected while nobody was listening
+        observables.gravity = integrator.gravity.y;
+        observables.floor = FloorHeight();
+        observables.Measure(disks, rects, polys, 0.0, observableSample);
+        observableTicks = 0;
+        observableTime = 0.0;
+    }
 }
 
 void Game::Render()
 {
+    PROFILE_ZONE("Game::Render");
+
+    overlay.BeginPhase(PerfOverlay::render);
+
     graphics->ClearRenderer();
 
     // DRAW CALLS GO HERE
 
-    for (auto& c : disks)
-    {
-        c->draw();
-    }
+    // Only what the camera can see, proxies are from this frame's broadphase so pad for the last integration
+    camera.Apply(graphics);
+    BoundingBox view = camera.VisibleBounds().Expanded(CULL_MARGIN);
 
-    for (auto& r : rects)
+    visibleStatic.clear();
+    staticGeometry.Query(view, visibleStatic);
+    for (int i : visibleStatic)
     {
-        r->draw();
+        graphics->DrawPolygon(STATIC_COLOUR, staticGeometry.Collider(i).polygon);
     }
 
-    for (auto& p : polys)
+    visibleBodies.clear();
+    broadphase.Query(proxies, view, visibleBodies);
+
+    // Back in body order so groups keep a stable layering
+    std::sort(visibleBodies.begin(), visibleBodies.end());
+    for (int i : visibleBodies)
     {
-        p->draw();
+        bodyEntities[i]->draw();
     }
+    counters.drawnBodies = static_cast<unsigned int>(visibleBodies.size());
+
+    graphics->ResetView();
+
+    overlay.Draw();
 
     graphics->Render();
+
+    overlay.EndPhase(PerfOverlay::render);
 }
 
 
@@ -156,6 +390,7 @@ void Game::Run()
     while (!quit)
     {
         timer->Reset();
+        overlay.BeginFrame();
 
         while (SDL_PollEvent(&event) != 0)
         {
@@ -165,25 +400,109 @@ void Game::Run()
             }
         }
 
+        // Hotkeys come from the live keyboard, a replay only drives the simulation
+
         // TODO remove this in favour of a menu
-        if (input->KeyPressed(SDL_SCANCODE_ESCAPE))
+        if (input->HotkeyPressed(SDL_SCANCODE_ESCAPE))
         {
             quit = true;
         }
 
-        EarlyUpdate();
+        if (input->HotkeyPressed(SDL_SCANCODE_F1))
+        {
+            overlay.Toggle();
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F5) && replay->Mode() != Replay::playing)
+        {
+            if (replay->Mode() == Replay::recording)
+                StopReplay();
+            else
+                StartRecording("replay.bin");
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F6))
+        {
+            if (replay->Mode() == Replay::playing)
+                StopReplay();
+            else
+                StartReplay("replay.bin");
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F7))
+        {
+            ToggleObservableLog("observables.csv");
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F8))
+        {
+            Profiler::GetInstance()->ExportChromeTrace("trace.json");
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F2))
+        {
+            SaveSnapshot("world.snap");
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F3))
+        {
+            LoadSnapshot("world.snap");
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F4))
+        {
+            SetTurbo(!turbo);
+        }
+
+        if (input->HotkeyPressed(SDL_SCANCODE_F9))
+        {
+            FastForward(FAST_FORWARD_SECS);
+        }
+
+        // Once per rendered frame on the wall clock, so turbo and fast forward do not speed it up.
+        // A replay moves it tick by tick instead.
+        Uint64 now = SDL_GetPerformanceCounter();
+        float frameSecs = static_cast<float>(now - cameraCounter) / SDL_GetPerformanceFrequency();
+        cameraCounter = now;
+
+        if (replay->Mode() != Replay::playing)
+        {
+            camera.Update(input, std::min(frameSecs, MAX_CAMERA_SECS));
+        }
 
-        Update();
-        
-        LateUpdate();
+        input->UpdateHotkeys();
+
+        if (turbo)
+        {
+            // At least one step, so a frame slower than the interval still advances
+            Uint64 start = SDL_GetPerformanceCounter();
+            Uint64 budget = static_cast<Uint64>(TURBO_FRAME_SECS * SDL_GetPerformanceFrequency());
+            do
+            {
+                Step();
+                counters.steps++;
+            } while (!quit && SDL_GetPerformanceCounter() - start < budget);
+        }
+        else
+        {
+            Step();
+            counters.steps++;
+        }
 
         Render();
 
+        if (overlay.Visible())
+        {
+            CountBodies();
+        }
+        overlay.EndFrame(counters);
+        counters = FrameCounters();
+
         // CRUDE FRAME RATE LIMITER
         timer->Update();
-        if (timer->DeltaTime() < FRAME_SECS)
+        if (!turbo && timer->ElapsedTime() < FRAME_SECS)
         {
-            SDL_Delay(1000.f * (FRAME_SECS - timer->DeltaTime()));
+            SDL_Delay(1000.f * (FRAME_SECS - timer->ElapsedTime()));
         }
 
         timer->Update();
@@ -193,122 +512,1469 @@ void Game::Run()
 
 
 
-void Game::HandleCollision()
+void Game::Step()
+{
+    EarlyUpdate();
+    Update();
+    LateUpdate();
+}
+
+void Game::ResetWorld()
+{
+    manager.destroyAll();
+    manager.refresh();
+
+    broadphase.Clear();
+    contactCache.Clear();
+    chunks.Clear();
+
+    // Commands recorded against the old world must not reach the new one
+    commands.Clear();
+    hardDiskEntities.clear();
+    motionEntities.clear();
+
+    // These point at entities that no longer exist until the next collision step
+    proxies.clear();
+    bodyEntities.clear();
+    queryBodiesValid = false;
+}
+
+bool Game::StartRecording(std::string path, uint64_t seed)
+{
+    StopReplay();
+
+    random.Seed(seed);
+
+    // Spawn positions depend on the camera, so record and replay both start from the default view
+    camera.Reset();
+
+    // The first keyframe snapshots the current world, so recording can start from a checkpoint
+    if (!replay->StartRecording(path, seed, FRAME_SECS))
+        return false;
+
+    timer->SetFixedTimeStep(FRAME_SECS);
+    return true;
+}
+
+bool Game::StartReplay(std::string path, unsigned int seekTick)
+{
+    StopReplay();
+
+    if (!replay->StartPlayback(path))
+        return false;
+
+    timer->SetFixedTimeStep(replay->FixedTimeStep());
+    input->SetReplayFrame(&inputFrame);
+    camera.Reset();
+
+    SeekReplay(seekTick);
+    return true;
+}
+
+void Game::SeekReplay(unsigned int target)
+{
+    if (replay->Mode() != Replay::playing)
+        return;
+
+    std::vector<char> payload;
+    replay->Seek(target, random, payload);
+
+    SnapshotView snapshot;
+    if (!payload.empty() && snapshot.Parse(payload.data(), payload.size()))
+    {
+        RestoreSnapshot(snapshot);
+        random = snapshot.rng;
+    }
+    else
+    {
+        // No world state in the keyframe, so rebuild from the start of the log
+        ResetWorld();
+    }
+
+    // Simulate the remaining ticks without rendering
+    while (replay->Mode() == Replay::playing && replay->Tick() < target)
+    {
+        Step();
+    }
+}
+
+Entity& Game::SpawnDisk(Vector2D centre, float radius, float density, Vector2D velocity)
+{
+    auto& disk(manager.addEntity());
+    disk.addComponent<DiskTransformComponent>(centre.x, centre.y, radius, density);
+    disk.addComponent<DiskSpriteComponent>();
+    disk.getComponent<DiskTransformComponent>().SetVelocity(velocity);
+    disk.addGroup(diskGroup);
+    return disk;
+}
+
+Entity& Game::SpawnRect(Vector2D position, Vector2D size, float density, Vector2D velocity)
+{
+    auto& rect(manager.addEntity());
+    rect.addComponent<RectTransformComponent>(position.x, position.y, size.x, size.y, density);
+    rect.addComponent<RectSpriteComponent>();
+    rect.getComponent<RectTransformComponent>().SetVelocity(velocity);
+    rect.addGroup(rectGroup);
+    return rect;
+}
+
+Entity& Game::SpawnPoly(const Polygon& polygon, float density, SDL_Color colour, Vector2D velocity)
+{
+    auto& poly(manager.addEntity());
+    poly.addComponent<PolyTransformComponent>(polygon, density, colour);
+    poly.getComponent<PolyTransformComponent>().velocity = velocity;
+    poly.addGroup(polyGroup);
+    return poly;
+}
+
+bool Game::SaveSnapshot(std::string path)
+{
+    SnapshotWriter snapshot;
+    CaptureSnapshot(snapshot);
+    return snapshot.Save(path);
+}
+
+bool Game::LoadSnapshot(std::string path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        printf("Snapshot file %s could not be opened!\n", path.c_str());
+        return false;
+    }
+
+    SnapshotView snapshot;
+    if (!snapshot.Parse(file.Data(), file.Size()))
+    {
+        printf("Snapshot file %s is not a valid snapshot!\n", path.c_str());
+        return false;
+    }
+
+    // A loaded world is not part of the input log, so stop any recording or replay
+    StopReplay();
+    RestoreSnapshot(snapshot);
+    random = snapshot.rng;
+    return true;
+}
+
+bool Game::LoadScene(std::string path)
 {
-    HandlePolyCollision();
-    HandleDiskCollision();
-    HandleRectCollision();
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        printf("Scene file %s could not be opened!\n", path.c_str());
+        return false;
+    }
+
+    SnapshotView scene;
+    std::vector<char> buffer;
+
+    // Binary scenes are read in place, text ones are parsed into a snapshot first
+    if (!scene.Parse(file.Data(), file.Size()))
+    {
+        SnapshotWriter text;
+        if (!SceneFile::ParseText(file.Data(), file.Size(), text))
+        {
+            printf("Scene file %s is not a valid scene!\n", path.c_str());
+            return false;
+        }
+
+        text.Serialise(buffer);
+        scene.Parse(buffer.data(), buffer.size());
+    }
+
+    // Like a snapshot, a scene is not part of the input log
+    StopReplay();
+    ResetWorld();
+    SpawnBodies(scene);
+    return true;
 }
 
-void Game::HandlePolyCollision()
+void Game::CaptureSnapshot(SnapshotWriter& snapshot)
 {
-    for (auto first = polys.begin(); first != polys.end(); ++first)
+    snapshot.Clear();
+    snapshot.rng = random;
+
+    snapshot.hasView = true;
+    snapshot.viewX = camera.Position().x;
+    snapshot.viewY = camera.Position().y;
+    snapshot.viewZoom = camera.Zoom();
+    snapshot.flags = (nBodyGravity ? nBodyGravityFlag : 0u) | (eventDriven ? eventDrivenFlag : 0u)
+        | (static_cast<uint32_t>(integrator.scheme) << INTEGRATOR_SHIFT);
+
+    snapshot.disks.reserve(disks.size());
+    for (auto& d : disks)
+    {
+        if (d->isActive())
+        {
+            CaptureBody(snapshot, *d, diskGroup);
+            snapshot.ids.push_back(d->getID());
+        }
+    }
+
+    snapshot.rects.reserve(rects.size());
+    for (auto& r : rects)
     {
-        for (auto second = first + 1; second != polys.end(); ++second)
+        if (r->isActive())
         {
-            Collision::ResolveSAT_Static((*first)->getComponent<PolyTransformComponent>().polygon,
-                (*second)->getComponent<PolyTransformComponent>().polygon);
+            CaptureBody(snapshot, *r, rectGroup);
+            snapshot.ids.push_back(r->getID());
         }
     }
+
+    snapshot.polys.reserve(polys.size());
+    for (auto& p : polys)
+    {
+        if (p->isActive())
+        {
+            CaptureBody(snapshot, *p, polyGroup);
+            snapshot.ids.push_back(p->getID());
+        }
+    }
+
+    // Verlet resumes from the accelerations the last step ended with. The lanes run polygons,
+    // disks, rects and the records disks, rects, polygons.
+    size_t bodies = snapshot.disks.size() + snapshot.rects.size() + snapshot.polys.size();
+    if (motionAccelerations && MotionLaidOut() && bodies == motion.Size())
+    {
+        snapshot.accelerations.reserve(bodies);
+        for (size_t i = polys.size(); i < bodies; i++)
+            snapshot.accelerations.push_back({ motion.ax[i], motion.ay[i] });
+
+        for (size_t i = 0; i < polys.size(); i++)
+            snapshot.accelerations.push_back({ motion.ax[i], motion.ay[i] });
+    }
+
+    CaptureSolverState(snapshot);
+
+    // Stored chunks stay stored, sorted so equal worlds give equal bytes
+    chunks.ForEachStored([&snapshot](int x, int y, const std::vector<char>& data)
+        {
+            snapshot.chunks.push_back({ x, y, data });
+        });
+
+    std::sort(snapshot.chunks.begin(), snapshot.chunks.end(), [](const SnapshotChunk& a, const SnapshotChunk& b)
+        {
+            return WorldChunks::Key(a.x, a.y) < WorldChunks::Key(b.x, b.y);
+        });
 }
 
-void Game::HandleDiskCollision()
+void Game::CaptureSolverState(SnapshotWriter& snapshot)
 {
-    for (auto first = disks.begin(); first != disks.end(); ++first) {
-        for (auto second = first + 1; second != disks.end(); ++second) {
+    snapshot.nextEntityID = manager.getNextID();
 
-            if (Collision::Disks((*first)->getComponent<DiskTransformComponent>().disk, (*second)->getComponent<DiskTransformComponent>().disk))
-            {
-                //std::cout << "Collision" << std::endl;
-
-                // Get collision parameters
-                Vector2D q0 = (*first)->getComponent<DiskTransformComponent>().disk.centre;
-                Vector2D q1 = (*second)->getComponent<DiskTransformComponent>().disk.centre;
-                Vector2D u0 = *(*first)->getComponent<DiskTransformComponent>().GetVelocity();
-                Vector2D u1 = *(*second)->getComponent<DiskTransformComponent>().GetVelocity();
-                float m0 = (*first)->getComponent<DiskTransformComponent>().Mass();
-                float m1 = (*second)->getComponent<DiskTransformComponent>().Mass();
-                float invM = 1.0f / (m0 + m1);
-                float r0 = (*first)->getComponent<DiskTransformComponent>().Radius();
-                float r1 = (*second)->getComponent<DiskTransformComponent>().Radius();
-
-                // Set up normal+tangent basis at approximate contact point
-                Vector2D normal = q1 - q0;
-                float distance = normal.Norm();
-                normal.Normalise();
-                Vector2D tangent = normal.Orth();
-
-                // Project velocity vectors onto our basis
-                float n0 = u0.Dot(normal);
-                float t0 = u0.Dot(tangent);
-                float n1 = u1.Dot(normal);
-                float t1 = u1.Dot(tangent);
-
-                // Solve 1D elastic collision in normal direction
-                float v0 = ((m0 - m1) * invM) * n0 + (2.0f * m1 * invM) * n1;
-                float v1 = (2.0f * m0 * invM) * n0 + ((m1 - m0) * invM) * n1;
-                (*first)->getComponent<DiskTransformComponent>().SetVelocity(v0 * normal + t0 * tangent);
-                (*second)->getComponent<DiskTransformComponent>().SetVelocity(v1 * normal + t1 * tangent);
-
-                // Separate colliders
-                (*first)->getComponent<DiskTransformComponent>().Translate(-0.5f * (r0 + r1 - distance) * normal);
-                (*second)->getComponent<DiskTransformComponent>().Translate(0.5f * (r0 + r1 - distance) * normal);
-            }
+    // Sorted, since the cache's slot layout depends on its history
+    contactCache.ForEach([&snapshot](const ContactManifold& m)
+        {
+            snapshot.contacts.push_back({ m.key, m.normal.x, m.normal.y, m.point.x, m.point.y, m.depth,
+                m.normalImpulse, m.tangentImpulse, m.age, m.touching ? 1u : 0u, 0u });
+        });
+
+    std::sort(snapshot.contacts.begin(), snapshot.contacts.end(), [](const ContactRecord& a, const ContactRecord& b)
+        {
+            return a.key < b.key;
+        });
+
+    // The proxies' entities may have been freed since the step that made them
+    if (queryBodiesValid)
+    {
+        for (const BroadphaseProxy& p : proxies)
+            snapshot.proxies.push_back({ p.bounds.min.x, p.bounds.min.y, p.bounds.max.x, p.bounds.max.y, p.id, p.layer });
+    }
+
+    snapshot.order.assign(broadphase.Order().begin(), broadphase.Order().end());
+    for (const BroadphasePair& p : broadphase.Pairs())
+        snapshot.pairs.push_back({ p.key, p.proxyA, p.proxyB });
 
-            // Attractive force
-            /*Vector2D sep = (*second)->getComponent<TransformComponent>().disk.centre - (*first)->getComponent<TransformComponent>().disk.centre;
-            Vector2D force = 100.0f * sep;
-            (*first)->getComponent<TransformComponent>().ApplyForce(force);
-            (*second)->getComponent<TransformComponent>().ApplyForce(-1.0f * force);*/
+    if (eventDriven && HardDisksTracked())
+        hardDisks.Serialise(snapshot.engine);
+}
 
+void Game::CaptureBody(SnapshotWriter& snapshot, Entity& entity, std::size_t group)
+{
+    if (group == diskGroup)
+    {
+        auto& t = entity.getComponent<DiskTransformComponent>();
+        Vector2D v = *t.GetVelocity();
+        snapshot.disks.push_back({ t.Centre()->x, t.Centre()->y, t.Radius(), v.x, v.y, t.Density(), t.GetRotation() });
+    }
+    else if (group == rectGroup)
+    {
+        auto& t = entity.getComponent<RectTransformComponent>();
+        Vector2D v = *t.GetVelocity();
+        snapshot.rects.push_back({ t.rect.x, t.rect.y, t.rect.w, t.rect.h, v.x, v.y, t.Density(), t.GetRotation() });
+    }
+    else
+    {
+        auto& t = entity.getComponent<PolyTransformComponent>();
+        SDL_Color c = t.Colour();
+        uint32_t colour = (static_cast<uint32_t>(c.r) << 24) | (c.g << 16) | (c.b << 8) | c.a;
+        uint32_t first = static_cast<uint32_t>(snapshot.vertices.size());
+        int n = t.polygon.Size();
 
+        for (int i = 0; i < n; i++)
+        {
+            snapshot.vertices.push_back({ t.polygon.vertices[i].x, t.polygon.vertices[i].y });
         }
+
+        snapshot.polys.push_back({ t.polygon.centre.x, t.polygon.centre.y, t.velocity.x, t.velocity.y,
+            t.density, t.theta, t.omega, colour, first, static_cast<uint32_t>(n) });
     }
 }
-void Game::HandleRectCollision()
+
+void Game::RestoreSnapshot(const SnapshotView& snapshot)
 {
-    for (auto first = rects.begin(); first != rects.end(); ++first) {
-        for (auto second = first + 1; second != rects.end(); ++second) {
+    ResetWorld();
+
+    if (snapshot.hasView)
+    {
+        camera.SetView(Vector2D(snapshot.viewX, snapshot.viewY), snapshot.viewZoom);
+    }
 
-            Vector2D contactPos, normal;
-            float contactTime = 0.0f;
+    nBodyGravity = (snapshot.flags & nBodyGravityFlag) != 0;
+    eventDriven = (snapshot.flags & eventDrivenFlag) != 0;
 
-            Rect firstRect = (*first)->getComponent<RectTransformComponent>().rect;
-            Rect secondRect = (*second)->getComponent<RectTransformComponent>().rect;
+    uint32_t scheme = (snapshot.flags & integratorFlags) >> INTEGRATOR_SHIFT;
+    integrator.scheme = scheme < Integrator::SCHEME_COUNT ? static_cast<Integrator::SCHEME>(scheme) : Integrator::leapfrog;
 
-            if (Collision::SweptAABB(firstRect, secondRect, timer->DeltaTime(), contactPos, normal, contactTime))
-            {
-                // HANDLE COLLISION
-                // Get collision parameters
-                Vector2D q0 = firstRect.Centre();
-                Vector2D q1 = secondRect.Centre();
-                Vector2D u0 = firstRect.GetVelocity();
-                Vector2D u1 = secondRect.GetVelocity();
-                float m0 = (*first)->getComponent<RectTransformComponent>().Mass();
-                float m1 = (*second)->getComponent<RectTransformComponent>().Mass();
-                float invM = 1.0f / (m0 + m1);
-                float size0 = std::abs(firstRect.GetSize().Dot(normal));
-                float size1 = std::abs(secondRect.GetSize().Dot(normal));
-
-                Vector2D tangent = normal.Orth();
-
-                // Project velocity vectors onto our basis
-                float n0 = u0.Dot(normal);
-                float t0 = u0.Dot(tangent);
-                float n1 = u1.Dot(normal);
-                float t1 = u1.Dot(tangent);
-
-                // Solve 1D elastic collision in normal direction
-                float v0 = ((m0 - m1) * invM) * n0 + (2.0f * m1 * invM) * n1;
-                float v1 = (2.0f * m0 * invM) * n0 + ((m1 - m0) * invM) * n1;
-                (*first)->getComponent<RectTransformComponent>().SetVelocity(v0 * normal + t0 * tangent);
-                (*second)->getComponent<RectTransformComponent>().SetVelocity(v1 * normal + t1 * tangent);
-
-                // Separate colliders
-                /*(*first)->getComponent<DiskTransformComponent>().Translate(-0.5f * (r0 + r1 - distance) * normal);
-                (*second)->getComponent<DiskTransformComponent>().Translate(0.5f * (r0 + r1 - distance) * normal);*/
+    SpawnBodies(snapshot);
+    if (snapshot.idCount != 0)
+        manager.setNextID(snapshot.nextEntityID);
 
-            }
+    LayOutMotion();
+    if (snapshot.accelerationCount != 0 && snapshot.accelerationCount == motion.Size())
+    {
+        size_t nonPolys = disks.size() + rects.size();
+        for (size_t i = 0; i < snapshot.accelerationCount; i++)
+        {
+            size_t lane = i < nonPolys ? polys.size() + i : i - nonPolys;
+            motion.ax[lane] = snapshot.accelerations[i].x;
+            motion.ay[lane] = snapshot.accelerations[i].y;
         }
+
+        motionAccelerations = true;
+    }
+
+    RestoreSolverState(snapshot);
+
+    for (size_t i = 0; i < snapshot.chunkCount; i++)
+    {
+        const ChunkRecord& c = snapshot.chunks[i];
+        const char* data = snapshot.ChunkData(i);
+        chunkBuffer.assign(data, data + c.size);
+        chunks.Store(c.x, c.y, chunkBuffer);
     }
 }
+
+void Game::RestoreSolverState(const SnapshotView& snapshot)
+{
+    // Only present along with the ids it is keyed by
+    if (snapshot.idCount == 0)
+        return;
+
+    for (size_t i = 0; i < snapshot.contactCount; i++)
+    {
+        const ContactRecord& c = snapshot.contacts[i];
+        ContactManifold& m = contactCache.Insert(c.key);
+        m.normal = Vector2D(c.normalX, c.normalY);
+        m.point = Vector2D(c.pointX, c.pointY);
+        m.depth = c.depth;
+        m.normalImpulse = c.normalImpulse;
+        m.tangentImpulse = c.tangentImpulse;
+        m.age = c.age;
+        m.touching = c.touching != 0;
+    }
+
+    // Proxies point back at their bodies by id
+    std::unordered_map<EntityID, Entity*> byID;
+    for (auto* group : { &disks, &rects, &polys })
+    {
+        for (Entity* e : *group)
+            byID[e->getID()] = e;
+    }
+
+    for (size_t i = 0; i < snapshot.proxyCount; i++)
+    {
+        const ProxyRecord& p = snapshot.proxies[i];
+        auto found = byID.find(p.id);
+        if (found == byID.end())
+        {
+            proxies.clear();
+            bodyEntities.clear();
+            break;
+        }
+
+        proxies.push_back({ BoundingBox(Vector2D(p.minX, p.minY), Vector2D(p.maxX, p.maxY)), p.id, p.layer });
+        bodyEntities.push_back(found->second);
+    }
+
+    std::vector<int> order(snapshot.order, snapshot.order + snapshot.orderCount);
+    std::vector<BroadphasePair> pairs;
+    for (size_t i = 0; i < snapshot.pairCount; i++)
+        pairs.push_back({ snapshot.pairs[i].key, snapshot.pairs[i].proxyA, snapshot.pairs[i].proxyB });
+
+    if (broadphase.Restore(proxies, order, pairs))
+    {
+        queryBodiesValid = proxies.size() == order.size();
+    }
+    else
+    {
+        // Back to what a restore without the state gives, the next step pairs from scratch
+        contactCache.Clear();
+        proxies.clear();
+        bodyEntities.clear();
+    }
+
+    if (eventDriven && snapshot.engineSize != 0 && hardDisks.Deserialise(snapshot.engine, snapshot.engineSize)
+        && hardDisks.Count() == disks.size())
+    {
+        TrackHardDisks();
+    }
+}
+
+void Game::SpawnBodies(const SnapshotView& snapshot)
+{
+    // Captured ids come back with their bodies, anything else takes new ones
+    const uint32_t* ids = snapshot.ids;
+    SpawnDisks(snapshot.disks, snapshot.diskCount, ids);
+    SpawnRects(snapshot.rects, snapshot.rectCount, ids != nullptr ? ids + snapshot.diskCount : nullptr);
+    SpawnPolys(snapshot.polys, snapshot.polyCount, snapshot.vertices, ids != nullptr ? ids + snapshot.diskCount + snapshot.rectCount : nullptr);
+}
+
+void Game::SpawnDisks(const DiskRecord* records, size_t count, const uint32_t* ids)
+{
+    PROFILE_ZONE("Game::SpawnDisks");
+
+    manager.reserve(count);
+    manager.reserveGroup(diskGroup, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const DiskRecord& d = records[i];
+        if (ids != nullptr)
+            manager.setNextID(ids[i]);
+
+        SpawnDisk(Vector2D(d.x, d.y), d.radius, d.density, Vector2D(d.vx, d.vy))
+            .getComponent<DiskTransformComponent>().SetRotation(d.theta);
+    }
+}
+
+void Game::SpawnRects(const RectRecord* records, size_t count, const uint32_t* ids)
+{
+    PROFILE_ZONE("Game::SpawnRects");
+
+    manager.reserve(count);
+    manager.reserveGroup(rectGroup, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const RectRecord& r = records[i];
+        if (ids != nullptr)
+            manager.setNextID(ids[i]);
+
+        SpawnRect(Vector2D(r.x, r.y), Vector2D(r.w, r.h), r.density, Vector2D(r.vx, r.vy))
+            .getComponent<RectTransformComponent>().SetRotation(r.theta);
+    }
+}
+
+void Game::SpawnPolys(const PolyRecord* records, size_t count, const VertexRecord* vertices, const uint32_t* ids)
+{
+    PROFILE_ZONE("Game::SpawnPolys");
+
+    manager.reserve(count);
+    manager.reserveGroup(polyGroup, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const PolyRecord& p = records[i];
+        if (p.vertexCount < 3)
+            continue;
+
+        Polygon polygon;
+        polygon.centre = Vector2D(p.x, p.y);
+        for (uint32_t v = 0; v < p.vertexCount; v++)
+        {
+            const VertexRecord& vertex = vertices[p.firstVertex + v];
+            polygon.AddVertex(Vector2D(vertex.x, vertex.y));
+        }
+
+        if (ids != nullptr)
+            manager.setNextID(ids[i]);
+
+        SDL_Color colour = { static_cast<Uint8>(p.colour >> 24), static_cast<Uint8>(p.colour >> 16),
+            static_cast<Uint8>(p.colour >> 8), static_cast<Uint8>(p.colour) };
+
+        auto& t = SpawnPoly(polygon, p.density, colour,
+            Vector2D(p.vx, p.vy)).getComponent<PolyTransformComponent>();
+        t.theta = p.theta;
+        t.omega = p.omega;
+    }
+}
+
+void Game::UpdateStreaming()
+{
+    PROFILE_ZONE("Game::UpdateStreaming");
+
+    chunks.SetFocus(camera.VisibleBounds().Expanded(STREAM_MARGIN));
+
+    // Restored in key order so entity ids do not depend on hash map iteration
+    chunkKeys.clear();
+    chunks.ForEachActiveStored([this](int x, int y)
+        {
+            chunkKeys.push_back(WorldChunks::Key(x, y));
+        });
+    std::sort(chunkKeys.begin(), chunkKeys.end());
+
+    for (uint64_t key : chunkKeys)
+    {
+        SnapshotView view;
+        if (chunks.Take(WorldChunks::KeyX(key), WorldChunks::KeyY(key), chunkBuffer)
+            && view.Parse(chunkBuffer.data(), chunkBuffer.size()))
+        {
+            SpawnBodies(view);
+        }
+    }
+
+    // Bodies are assigned to the chunk holding their centre
+    streamedBodies.clear();
+    auto gather = [this](std::vector<Entity*>& group, std::size_t label)
+        {
+            for (auto& e : group)
+            {
+                if (!e->isActive())
+                    continue;
+
+                Vector2D centre;
+                if (label == diskGroup)
+                    centre = *e->getComponent<DiskTransformComponent>().Centre();
+                else if (label == rectGroup)
+                    centre = e->getComponent<RectTransformComponent>().rect.Centre();
+                else
+                    centre = e->getComponent<PolyTransformComponent>().polygon.centre;
+
+                int x, y;
+                chunks.ChunkOf(centre, x, y);
+                if (!chunks.IsActive(x, y))
+                    streamedBodies.push_back({ WorldChunks::Key(x, y), label, e });
+            }
+        };
+
+    gather(disks, diskGroup);
+    gather(rects, rectGroup);
+    gather(polys, polyGroup);
+
+    if (streamedBodies.empty())
+        return;
+
+    // Stable, so each chunk keeps the group and spawn order of its bodies
+    std::stable_sort(streamedBodies.begin(), streamedBodies.end(), [](const StreamedBody& a, const StreamedBody& b)
+        {
+            return a.key < b.key;
+        });
+
+    size_t first = 0;
+    for (size_t i = 1; i <= streamedBodies.size(); i++)
+    {
+        if (i == streamedBodies.size() || streamedBodies[i].key != streamedBodies[first].key)
+        {
+            StoreChunk(streamedBodies[first].key, &streamedBodies[first], &streamedBodies[0] + i);
+            first = i;
+        }
+    }
+}
+
+void Game::StoreChunk(uint64_t key, const StreamedBody* first, const StreamedBody* last)
+{
+    int x = WorldChunks::KeyX(key);
+    int y = WorldChunks::KeyY(key);
+
+    chunkWriter.Clear();
+
+    // Bodies drifting into a chunk that is already stored join its buffer
+    SnapshotView stored;
+    if (chunks.Take(x, y, chunkBuffer) && stored.Parse(chunkBuffer.data(), chunkBuffer.size()))
+    {
+        chunkWriter.Append(stored);
+    }
+
+    for (const StreamedBody* b = first; b != last; b++)
+    {
+        CaptureBody(chunkWriter, *b->entity, b->group);
+        b->entity->destroy();
+    }
+
+    chunkWriter.Serialise(chunkBuffer);
+    chunks.Store(x, y, chunkBuffer);
+}
+
+void Game::StopReplay()
+{
+    replay->Stop();
+    input->SetReplayFrame(nullptr);
+    timer->SetFixedTimeStep(turbo ? FRAME_SECS : 0.0f);
+}
+
+void Game::SetTurbo(bool enabled)
+{
+    turbo = enabled;
+
+    // Steps are only decoupled from the wall clock with a fixed step, record and replay already have one
+    if (replay->Mode() == Replay::idle)
+        timer->SetFixedTimeStep(turbo ? FRAME_SECS : 0.0f);
+}
+
+void Game::FastForward(float seconds)
+{
+    PROFILE_ZONE("Game::FastForward");
+
+    Replay::MODE mode = replay->Mode();
+    bool variable = timer->FixedTimeStep() <= 0.0f;
+    if (variable)
+        timer->SetFixedTimeStep(FRAME_SECS);
+
+    // Stops early if a replay runs out, the step would fall back to the wall clock
+    unsigned int steps = static_cast<unsigned int>(std::ceil(seconds / timer->FixedTimeStep()));
+    for (unsigned int i = 0; i < steps && replay->Mode() == mode; i++)
+    {
+        if (i % FAST_FORWARD_PUMP == 0)
+            SDL_PumpEvents();
+
+        Step();
+    }
+
+    if (variable)
+        timer->SetFixedTimeStep(0.0f);
+
+    // The frame's wall-clock delta would otherwise include the whole fast forward
+    timer->Reset();
+}
+
+void Game::SetNBodyGravity(bool enabled)
+{
+    nBodyGravity = enabled;
+    motionAccelerations = false;
+}
+
+BarnesHut& Game::GravityTree()
+{
+    return gravityTree;
+}
+
+bool Game::SetEventDriven(bool enabled)
+{
+    if (enabled && !EventDrivenAllowed())
+    {
+        printf("Event-driven disks need a world of disks in the default arena without n-body gravity\n");
+        return false;
+    }
+
+    eventDriven = enabled;
+    hardDiskEntities.clear();
+
+    // The engine moves the bodies without them
+    motionAccelerations = false;
+
+    // Pairs stop being diffed into the contact cache while the engine runs
+    broadphase.Clear();
+    contactCache.Clear();
+    return true;
+}
+
+HardDiskEngine& Game::HardDisks()
+{
+    return hardDisks;
+}
+
+void Game::SetIntegrator(Integrator::SCHEME scheme)
+{
+    integrator.scheme = scheme;
+    motionAccelerations = false;
+    printf("Integrator: %s\n", Integrator::Name(scheme));
+}
+
+Integrator& Game::Integration()
+{
+    return integrator;
+}
+
+bool Game::EventDrivenAllowed()
+{
+    return arenaGeometry && !nBodyGravity && rects.empty() && polys.empty();
+}
+
+bool Game::HardDisksTracked()
+{
+    return hardDiskEntities.size() == disks.size() && std::equal(disks.begin(), disks.end(), hardDiskEntities.begin());
+}
+
+void Game::TrackHardDisks()
+{
+    size_t n = disks.size();
+    hardDiskEntities.assign(disks.begin(), disks.end());
+    hardDiskPositions.resize(n);
+    hardDiskVelocities.resize(n);
+    hardDiskRadii.resize(n);
+    hardDiskMasses.resize(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        auto& t = disks[i]->getComponent<DiskTransformComponent>();
+        hardDiskPositions[i] = *t.Centre();
+        hardDiskVelocities[i] = *t.GetVelocity();
+        hardDiskRadii[i] = t.Radius();
+        hardDiskMasses[i] = t.Mass();
+    }
+}
+
+void Game::StepHardDisks()
+{
+    PROFILE_ZONE("Game::StepHardDisks");
+
+    size_t n = disks.size();
+
+    // Spawns, streaming and restores without engine state change the disks, which restarts the engine from them
+    if (!HardDisksTracked())
+    {
+        TrackHardDisks();
+        hardDisks.Load(hardDiskPositions.data(), hardDiskVelocities.data(), hardDiskRadii.data(), hardDiskMasses.data(), n, arenaBounds);
+    }
+    else
+    {
+        // Only disks pushed from outside, by antigravity or a snapshot edit, are predicted again
+        for (size_t i = 0; i < n; i++)
+        {
+            auto& t = disks[i]->getComponent<DiskTransformComponent>();
+            if (!(*t.Centre() == hardDiskPositions[i]) || !(*t.GetVelocity() == hardDiskVelocities[i]))
+                hardDisks.Set(i, *t.Centre(), *t.GetVelocity());
+        }
+    }
+
+    hardDisks.Advance(timer->DeltaTime());
+
+    contacts.clear();
+    contactEvents.clear();
+    bodyEntities.clear();
+    proxies.clear();
+
+    for (size_t i = 0; i < n; i++)
+    {
+        auto& t = disks[i]->getComponent<DiskTransformComponent>();
+        hardDiskPositions[i] = hardDisks.Position(i);
+        hardDiskVelocities[i] = hardDisks.Velocity(i);
+        t.SetPosition(hardDiskPositions[i]);
+        t.SetVelocity(hardDiskVelocities[i]);
+        t.AddWallImpulse(hardDisks.TakeWallImpulse(i));
+
+        disks[i]->getComponent<DiskSpriteComponent>().Update();
+
+        bodyEntities.push_back(disks[i]);
+        proxies.push_back({ t.Bounds(), disks[i]->getID(), static_cast<int>(diskGroup) });
+    }
+
+    // Culling and scene queries still go through the broadphase
+    broadphase.Update(proxies);
+    queryBodiesValid = true;
+}
+
+namespace
+{
+    // Velocities come from and go back to the motion arrays, which share the solver's layout
+    template <typename T> void GatherBodies(const std::vector<Entity*>& group, Game::groupLabels layer, float restitution, float friction,
+        const MotionArrays& motion, std::vector<SolverBody>& bodies, std::vector<Entity*>& entities, std::vector<BroadphaseProxy>& proxies)
+    {
+        for (auto& e : group)
+        {
+            auto& t = e->getComponent<T>();
+            float mass = t.Mass();
+            bodies.push_back({ motion.Velocity(bodies.size()), VEC_ZERO, mass > 0.0f ? 1.0f / mass : 0.0f, restitution, friction });
+            entities.push_back(e);
+            proxies.push_back({ t.Bounds(), e->getID(), static_cast<int>(layer) });
+        }
+    }
+
+    template <typename T> void ScatterBodies(const std::vector<Entity*>& group, const SolverBody* bodies, size_t first, float dt, MotionArrays& motion)
+    {
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            motion.SetVelocity(first + i, bodies[first + i].velocity);
+            group[i]->getComponent<T>().Translate(dt * bodies[first + i].pseudoVelocity);
+        }
+    }
+
+    template <typename T> void GatherMotionGroup(const std::vector<Entity*>& group, MotionArrays& m, size_t first)
+    {
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            m.SetVelocity(first + i, *group[i]->getComponent<T>().GetVelocity());
+        }
+    }
+
+    template <typename T> void TranslateMotionGroup(const std::vector<Entity*>& group, const MotionArrays& m, size_t first)
+    {
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            group[i]->getComponent<T>().Translate(Vector2D(m.dx[first + i], m.dy[first + i]));
+        }
+    }
+
+    template <typename T> void ScatterMotionGroup(const std::vector<Entity*>& group, const MotionArrays& m, size_t first, bool translate)
+    {
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            auto& t = group[i]->getComponent<T>();
+            t.SetVelocity(m.Velocity(first + i));
+
+            if (translate)
+                t.Translate(Vector2D(m.dx[first + i], m.dy[first + i]));
+        }
+    }
+
+    // Records a destroy for every body that blew up to inf or nan, or whose bounds lie entirely
+    // outside limit. Chunk k of the group records into buffer first + k.
+    template <typename T> void CullEscapedGroup(ThreadPool* pool, const std::vector<Entity*>& group, const BoundingBox* limit,
+        size_t minChunk, CommandBuffers& commands, size_t first)
+    {
+        pool->ParallelFor(group.size(), minChunk, [&](size_t chunk, size_t begin, size_t end)
+            {
+                CommandBuffer& buffer = commands[first + chunk];
+                for (size_t i = begin; i < end; i++)
+                {
+                    auto& t = group[i]->getComponent<T>();
+                    BoundingBox bounds = t.Bounds();
+                    Vector2D v = *t.GetVelocity();
+
+                    bool finite = std::isfinite(bounds.min.x) && std::isfinite(bounds.min.y) && std::isfinite(bounds.max.x)
+                        && std::isfinite(bounds.max.y) && std::isfinite(v.x) && std::isfinite(v.y);
+
+                    if (!finite || (limit != nullptr && !bounds.Overlaps(*limit)))
+                        buffer.destroy(CommandBuffer::Existing(group[i]->getHandle()));
+                }
+            });
+    }
+}
+
+void Game::IntegrateBegin()
+{
+    PROFILE_ZONE("Game::IntegrateBegin");
+
+    // The one gather of the step, the motion arrays hold the velocities until IntegrateEnd
+    LayOutMotion();
+    GatherMotion();
+
+    if (!integrator.Begins())
+        return;
+
+    // Verlet's first half kick reuses the accelerations from the end of the last step, they are
+    // only evaluated here when the bodies or the forces changed since
+    if (integrator.scheme == Integrator::velocityVerlet && !motionAccelerations)
+        Accelerations();
+
+    integrator.Begin(motion, timer->DeltaTime());
+    TranslateMotion();
+}
+
+void Game::IntegrateForces()
+{
+    PROFILE_ZONE("Game::IntegrateForces");
+
+    Accelerations();
+    integrator.Kick(motion, timer->DeltaTime());
+}
+
+void Game::IntegrateEnd()
+{
+    PROFILE_ZONE("Game::IntegrateEnd");
+
+    integrator.End(motion, timer->DeltaTime());
+
+    // The one scatter of the step, velocities go back along with the last drift
+    ScatterMotion(integrator.Ends());
+}
+
+bool Game::MotionLaidOut() const
+{
+    size_t firstDisk = polys.size();
+    size_t firstRect = firstDisk + disks.size();
+
+    return motionEntities.size() == firstRect + rects.size()
+        && std::equal(polys.begin(), polys.end(), motionEntities.begin())
+        && std::equal(disks.begin(), disks.end(), motionEntities.begin() + firstDisk)
+        && std::equal(rects.begin(), rects.end(), motionEntities.begin() + firstRect);
+}
+
+bool Game::LayOutMotion()
+{
+    if (MotionLaidOut())
+        return false;
+
+    size_t firstDisk = polys.size();
+    size_t n = firstDisk + disks.size() + rects.size();
+
+    motionEntities.assign(polys.begin(), polys.end());
+    motionEntities.insert(motionEntities.end(), disks.begin(), disks.end());
+    motionEntities.insert(motionEntities.end(), rects.begin(), rects.end());
+
+    motion.Resize(n);
+
+    // Polygons float, as they always have
+    std::fill(motion.gravityScale.begin() + firstDisk, motion.gravityScale.begin() + n, 1.0f);
+
+    motionAccelerations = false;
+    return true;
+}
+
+void Game::GatherMotion()
+{
+    GatherMotionGroup<PolyTransformComponent>(polys, motion, 0);
+    GatherMotionGroup<DiskTransformComponent>(disks, motion, polys.size());
+    GatherMotionGroup<RectTransformComponent>(rects, motion, polys.size() + disks.size());
+}
+
+void Game::TranslateMotion()
+{
+    TranslateMotionGroup<PolyTransformComponent>(polys, motion, 0);
+    TranslateMotionGroup<DiskTransformComponent>(disks, motion, polys.size());
+    TranslateMotionGroup<RectTransformComponent>(rects, motion, polys.size() + disks.size());
+}
+
+void Game::ScatterMotion(bool translate)
+{
+    ScatterMotionGroup<PolyTransformComponent>(polys, motion, 0, translate);
+    ScatterMotionGroup<DiskTransformComponent>(disks, motion, polys.size(), translate);
+    ScatterMotionGroup<RectTransformComponent>(rects, motion, polys.size() + disks.size(), translate);
+}
+
+void Game::CullEscapedBodies()
+{
+    PROFILE_ZONE("Game::CullEscapedBodies");
+
+    // Custom geometry may reach anywhere, only the default arena has a known outside. A body
+    // beyond its walls tunnelled through them and would fall forever.
+    BoundingBox outside = arenaBounds.Expanded(WALL_THICKNESS);
+    const BoundingBox* limit = arenaGeometry ? &outside : nullptr;
+
+    // The groups' chunks take consecutive buffers, so the destroys apply in body order whatever
+    // the thread count
+    size_t polyChunks = threadPool->ChunkCount(polys.size(), CULL_CHUNK);
+    size_t diskChunks = threadPool->ChunkCount(disks.size(), CULL_CHUNK);
+    commands.Prepare(polyChunks + diskChunks + threadPool->ChunkCount(rects.size(), CULL_CHUNK));
+
+    CullEscapedGroup<PolyTransformComponent>(threadPool, polys, limit, CULL_CHUNK, commands, 0);
+    CullEscapedGroup<DiskTransformComponent>(threadPool, disks, limit, CULL_CHUNK, commands, polyChunks);
+    CullEscapedGroup<RectTransformComponent>(threadPool, rects, limit, CULL_CHUNK, commands, polyChunks + diskChunks);
+}
+
+void Game::Accelerations()
+{
+    integrator.Gravity(motion);
+
+    if (nBodyGravity)
+        AddNBodyGravity();
+
+    motionAccelerations = true;
+}
+
+void Game::AddNBodyGravity()
+{
+    PROFILE_ZONE("Game::AddNBodyGravity");
+
+    size_t n = disks.size();
+    gravityPositions.resize(n);
+    gravityMasses.resize(n);
+    gravityAccelerations.resize(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        auto& t = disks[i]->getComponent<DiskTransformComponent>();
+        gravityPositions[i] = *t.Centre();
+        gravityMasses[i] = t.Mass();
+    }
+
+    gravityTree.Build(gravityPositions.data(), gravityMasses.data(), n);
+    gravityTree.Accelerations(gravityAccelerations.data());
+
+    size_t first = polys.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        motion.ax[first + i] += gravityAccelerations[i].x;
+        motion.ay[first + i] += gravityAccelerations[i].y;
+    }
+}
+
+void Game::HandleCollision()
+{
+    PROFILE_ZONE("Game::HandleCollision");
+
+    // Bodies are laid out group by group, proxy i belongs to body i
+    solverBodies.clear();
+    bodyEntities.clear();
+    proxies.clear();
+    GatherBodies<PolyTransformComponent>(polys, polyGroup, POLY_RESTITUTION, POLY_FRICTION, motion, solverBodies, bodyEntities, proxies);
+    GatherBodies<DiskTransformComponent>(disks, diskGroup, DISK_RESTITUTION, DISK_FRICTION, motion, solverBodies, bodyEntities, proxies);
+    GatherBodies<RectTransformComponent>(rects, rectGroup, RECT_RESTITUTION, RECT_FRICTION, motion, solverBodies, bodyEntities, proxies);
+
+    broadphase.Update(proxies);
+    queryBodiesValid = true;
+    UpdateContacts();
+
+    float dt = timer->DeltaTime();
+    solver.Solve(solverBodies, contacts, dt);
+
+    int dynamicBodies = static_cast<int>(bodyEntities.size());
+
+    for (const auto& c : contacts)
+    {
+        ContactManifold* m = contactCache.Find(c.key);
+        m->normalImpulse = c.normalImpulse;
+        m->tangentImpulse = c.tangentImpulse;
+
+        if (c.bodyB >= dynamicBodies)
+        {
+            AddWallImpulse(c.bodyA, c.normalImpulse);
+        }
+
+        bool began = m->age == 0;
+        contactEvents.push_back({ began ? ContactEvent::begin : ContactEvent::persist, c.key, c.point, c.normal, c.approachSpeed });
+
+        if (began && c.approachSpeed < 0.0f)
+        {
+            audio->QueueImpact(impactSFX, -c.approachSpeed / IMPACT_SPEED);
+        }
+    }
+
+    ScatterBodies<PolyTransformComponent>(polys, solverBodies.data(), 0, dt, motion);
+    ScatterBodies<DiskTransformComponent>(disks, solverBodies.data(), polys.size(), dt, motion);
+    ScatterBodies<RectTransformComponent>(rects, solverBodies.data(), polys.size() + disks.size(), dt, motion);
+
+    SweepFastDisks(dt);
+}
+
+void Game::SweepFastDisks(float dt)
+{
+    PROFILE_ZONE("Game::SweepFastDisks");
+
+    // Until the next collision step a disk follows centre + s * dt * velocity for s in [0, 1], so
+    // every disk stays within reach of the bounds its proxy was given this step. Velocities are
+    // read from and written to the motion arrays, body i of the solver is lane i.
+    int firstDisk = static_cast<int>(polys.size());
+
+    float reach = 0.0f;
+    fastDisks.clear();
+    for (int i = 0; i < static_cast<int>(disks.size()); i++)
+    {
+        float distance = dt * motion.Velocity(firstDisk + i).Norm();
+        reach = std::max(reach, distance);
+
+        if (distance > CCD_FRACTION * disks[i]->getComponent<DiskTransformComponent>().Radius())
+            fastDisks.push_back(i);
+    }
+
+    for (int i : fastDisks)
+    {
+        auto& a = disks[i]->getComponent<DiskTransformComponent>();
+        Vector2D position = *a.Centre();
+
+        // Fraction of the step covered up to the last impact
+        float elapsed = 0.0f;
+
+        for (int impact = 0; impact < CCD_MAX_IMPACTS; impact++)
+        {
+            Vector2D velocity = motion.Velocity(firstDisk + i);
+            Vector2D sweep = (1.0f - elapsed) * dt * velocity;
+            Disk swept(a.Radius(), position.x, position.y);
+            BoundingBox box = swept.Bounds().Swept(sweep).Expanded(reach);
+
+            float nearest = 1.0f;
+            Vector2D normal;
+            int collider = -1;
+            int other = -1;
+
+            ccdStatic.clear();
+            staticGeometry.Query(box, ccdStatic);
+            for (int s : ccdStatic)
+            {
+                float t;
+                Vector2D n;
+                if (Collision::SweptDiskPolygon(swept, sweep, staticGeometry.Collider(s).polygon, t, n) && t < nearest)
+                {
+                    nearest = t;
+                    normal = n;
+                    collider = s;
+                }
+            }
+
+            // Other disks move too, so each is swept against in its own frame
+            queryCandidates.clear();
+            broadphase.Query(proxies, box, queryCandidates);
+            for (int proxy : queryCandidates)
+            {
+                if (proxies[proxy].layer != diskGroup || proxy == firstDisk + i)
+                    continue;
+
+                auto& b = bodyEntities[proxy]->getComponent<DiskTransformComponent>();
+                Vector2D otherVelocity = motion.Velocity(proxy);
+                Vector2D target = *b.Centre() + elapsed * dt * otherVelocity;
+
+                float t;
+                Vector2D n;
+                if (Collision::SweptDisk(swept, (1.0f - elapsed) * dt * (velocity - otherVelocity),
+                    Disk(b.Radius(), target.x, target.y), t, n) && t < nearest)
+                {
+                    nearest = t;
+                    normal = n;
+                    collider = -1;
+                    other = proxy;
+                }
+            }
+
+            if (collider < 0 && other < 0)
+                break;
+
+            position += nearest * sweep;
+            elapsed += nearest * (1.0f - elapsed);
+
+            if (other < 0)
+            {
+                float restitution = std::max(DISK_RESTITUTION, staticGeometry.Collider(collider).restitution);
+                float impulse = -(1.0f + restitution) * velocity.Dot(normal) * a.Mass();
+                motion.SetVelocity(firstDisk + i, velocity + (impulse / a.Mass()) * normal);
+                a.AddWallImpulse(impulse);
+            }
+            else
+            {
+                auto& b = bodyEntities[other]->getComponent<DiskTransformComponent>();
+                Vector2D before = motion.Velocity(other);
+                float impulse = -(1.0f + DISK_RESTITUTION) * (velocity - before).Dot(normal) / (1.0f / a.Mass() + 1.0f / b.Mass());
+                motion.SetVelocity(firstDisk + i, velocity + (impulse / a.Mass()) * normal);
+
+                // The other disk stays where it is and takes the new velocity for its whole drift.
+                // Moving it as well could push it into bodies it was never swept against, and
+                // whatever overlap remains is the contact solver's next step.
+                motion.SetVelocity(other, before - (impulse / b.Mass()) * normal);
+            }
+        }
+
+        // The drift still to come covers dt * velocity, so start it far enough back that the
+        // path passes through the last impact at elapsed
+        a.SetPosition(position - elapsed * dt * motion.Velocity(firstDisk + i));
+    }
+}
+
+void Game::UpdateContacts()
+{
+    PROFILE_ZONE("Game::UpdateContacts");
+
+    contacts.clear();
+    contactEvents.clear();
+
+    for (uint64_t key : broadphase.Ended())
+    {
+        ContactManifold* m = contactCache.Find(key);
+        if (m != nullptr && m->touching)
+        {
+            contactEvents.push_back({ ContactEvent::end, key, m->point, m->normal, 0.0f });
+        }
+        contactCache.Remove(key);
+    }
+
+    for (uint64_t key : broadphase.Began())
+    {
+        contactCache.Insert(key);
+    }
+
+    Manifold manifold;
+
+    for (const auto& pair : broadphase.Pairs())
+    {
+        counters.candidatePairs++;
+
+        ContactManifold* m = contactCache.Find(pair.key);
+
+        if (!Narrowphase(pair, manifold))
+        {
+            // Bounds still overlap, so the entry stays cached but stops carrying impulse
+            if (m->touching)
+            {
+                contactEvents.push_back({ ContactEvent::end, pair.key, m->point, m->normal, 0.0f });
+                m->touching = false;
+                m->normalImpulse = 0.0f;
+                m->tangentImpulse = 0.0f;
+            }
+            continue;
+        }
+
+        counters.narrowphaseHits++;
+
+        m->age = m->touching ? m->age + 1 : 0;
+        m->touching = true;
+        m->normal = manifold.normal;
+        m->point = manifold.point;
+        m->depth = manifold.depth;
+
+        Contact c;
+        c.bodyA = pair.proxyA;
+        c.bodyB = pair.proxyB;
+
+        // Static colliders get an immovable body of their own so the solver sees their material
+        if (pair.IsStatic())
+        {
+            const StaticCollider& collider = staticGeometry.Collider(pair.StaticIndex());
+            c.bodyB = static_cast<int>(solverBodies.size());
+            solverBodies.push_back({ VEC_ZERO, VEC_ZERO, 0.0f, collider.restitution, collider.friction });
+        }
+
+        c.key = pair.key;
+        c.normal = manifold.normal;
+        c.point = manifold.point;
+        c.depth = manifold.depth;
+        c.normalImpulse = m->normalImpulse;
+        c.tangentImpulse = m->tangentImpulse;
+        contacts.push_back(c);
+    }
+}
+
+bool Game::Narrowphase(const BroadphasePair& pair, Manifold& manifold)
+{
+    Entity* first = bodyEntities[pair.proxyA];
+
+    if (pair.IsStatic())
+    {
+        const Polygon& wall = staticGeometry.Collider(pair.StaticIndex()).polygon;
+
+        switch (proxies[pair.proxyA].layer)
+        {
+        case polyGroup:
+            return Collision::PolygonContact(first->getComponent<PolyTransformComponent>().polygon, wall, manifold);
+
+        case diskGroup:
+            return Collision::DiskPolygonContact(first->getComponent<DiskTransformComponent>().disk, wall, manifold);
+
+        case rectGroup:
+            return Collision::RectPolygonContact(first->getComponent<RectTransformComponent>().rect, wall, manifold);
+        }
+
+        return false;
+    }
+
+    Entity* second = bodyEntities[pair.proxyB];
+
+    switch (proxies[pair.proxyA].layer)
+    {
+    case polyGroup:
+        return Collision::PolygonContact(first->getComponent<PolyTransformComponent>().polygon,
+            second->getComponent<PolyTransformComponent>().polygon, manifold);
+
+    case diskGroup:
+        return Collision::DiskContact(first->getComponent<DiskTransformComponent>().disk,
+            second->getComponent<DiskTransformComponent>().disk, manifold);
+
+    case rectGroup:
+        return Collision::RectContact(first->getComponent<RectTransformComponent>().rect,
+            second->getComponent<RectTransformComponent>().rect, manifold);
+    }
+
+    return false;
+}
+
+void Game::AddWallImpulse(int body, float impulse)
+{
+    Entity* e = bodyEntities[body];
+
+    switch (proxies[body].layer)
+    {
+    case polyGroup:
+        e->getComponent<PolyTransformComponent>().AddWallImpulse(impulse);
+        break;
+
+    case diskGroup:
+        e->getComponent<DiskTransformComponent>().AddWallImpulse(impulse);
+        break;
+
+    case rectGroup:
+        e->getComponent<RectTransformComponent>().AddWallImpulse(impulse);
+        break;
+    }
+}
+
+RayHit Game::Raycast(const Ray& ray)
+{
+    RayHit hit = {};
+    hit.distance = ray.length;
+
+    float distance;
+    Vector2D normal;
+    int collider = staticGeometry.Raycast(ray, distance, normal);
+    if (collider >= 0)
+    {
+        hit.hit = true;
+        hit.id = StaticGeometry::ID_BASE + collider;
+        hit.distance = distance;
+        hit.normal = normal;
+    }
+
+    if (queryBodiesValid)
+    {
+        // Bodies only need testing up to the static hit
+        Ray clipped = ray;
+        clipped.length = hit.distance;
+
+        broadphase.Raycast(clipped, [&](int proxy, float nearest)
+            {
+                float t;
+                Vector2D n;
+                if (!RaycastBody(proxy, clipped, t, n) || t >= nearest)
+                    return nearest;
+
+                hit.hit = true;
+                hit.id = proxies[proxy].id;
+                hit.entity = bodyEntities[proxy]->getHandle();
+                hit.distance = t;
+                hit.normal = n;
+                return t;
+            });
+    }
+
+    if (hit.hit)
+    {
+        hit.point = ray.At(hit.distance);
+    }
+    return hit;
+}
+
+void Game::Raycast(const Ray* rays, size_t count, RayHit* hits)
+{
+    PROFILE_ZONE("Game::Raycast");
+
+    // Every query only reads the world, so rays are independent
+    threadPool->ParallelFor(count, RAY_CHUNK, [&](size_t /*chunk*/, size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                hits[i] = Raycast(rays[i]);
+            }
+        });
+}
+
+bool Game::RaycastBody(int proxy, const Ray& ray, float& distance, Vector2D& normal)
+{
+    Entity* e = bodyEntities[proxy];
+    if (!e->isActive())
+        return false;
+
+    switch (proxies[proxy].layer)
+    {
+    case diskGroup:
+        return Collision::RayDisk(ray, e->getComponent<DiskTransformComponent>().disk, distance, normal);
+    case rectGroup:
+        return Collision::RayBox(ray, e->getComponent<RectTransformComponent>().rect.Bounds(), distance, normal);
+    default:
+        return Collision::RayPolygon(ray, e->getComponent<PolyTransformComponent>().polygon, distance, normal);
+    }
+}
+
+template <typename F> void Game::QueryBodies(const BoundingBox& box, std::vector<EntityHandle>& out, F overlaps)
+{
+    out.clear();
+    if (!queryBodiesValid)
+        return;
+
+    queryCandidates.clear();
+    broadphase.Query(proxies, box, queryCandidates);
+
+    for (int proxy : queryCandidates)
+    {
+        Entity* e = bodyEntities[proxy];
+        if (e->isActive() && overlaps(*e, static_cast<groupLabels>(proxies[proxy].layer)))
+            out.push_back(e->getHandle());
+    }
+}
+
+void Game::QueryAABB(const BoundingBox& box, std::vector<EntityHandle>& out)
+{
+    Rect rect(box.min.x, box.min.y, box.max.x - box.min.x, box.max.y - box.min.y);
+
+    QueryBodies(box, out, [&](Entity& e, groupLabels group)
+        {
+            Manifold m;
+            switch (group)
+            {
+            case diskGroup:
+            {
+                // Closest point of the box to the centre
+                const Disk& d = e.getComponent<DiskTransformComponent>().disk;
+                Vector2D closest(std::min(std::max(d.centre.x, box.min.x), box.max.x), std::min(std::max(d.centre.y, box.min.y), box.max.y));
+                return (d.centre - closest).NormSquared() <= d.radius * d.radius;
+            }
+            case rectGroup:
+                return e.getComponent<RectTransformComponent>().rect.Bounds().Overlaps(box);
+            default:
+                return Collision::RectPolygonContact(rect, e.getComponent<PolyTransformComponent>().polygon, m);
+            }
+        });
+}
+
+void Game::QueryRadius(Vector2D centre, float radius, std::vector<EntityHandle>& out)
+{
+    Disk region(radius, centre.x, centre.y);
+
+    QueryBodies(region.Bounds(), out, [&](Entity& e, groupLabels group)
+        {
+            Manifold m;
+            switch (group)
+            {
+            case diskGroup:
+                return Collision::DiskContact(region, e.getComponent<DiskTransformComponent>().disk, m);
+            case rectGroup:
+            {
+                BoundingBox r = e.getComponent<RectTransformComponent>().rect.Bounds();
+                Vector2D closest(std::min(std::max(centre.x, r.min.x), r.max.x), std::min(std::max(centre.y, r.min.y), r.max.y));
+                return (centre - closest).NormSquared() <= radius * radius;
+            }
+            default:
+                return Collision::DiskPolygonContact(region, e.getComponent<PolyTransformComponent>().polygon, m);
+            }
+        });
+}
+
+void Game::QueryPolygon(const Polygon& polygon, std::vector<EntityHandle>& out)
+{
+    QueryBodies(polygon.Bounds(), out, [&](Entity& e, groupLabels group)
+        {
+            Manifold m;
+            switch (group)
+            {
+            case diskGroup:
+                return Collision::DiskPolygonContact(e.getComponent<DiskTransformComponent>().disk, polygon, m);
+            case rectGroup:
+                return Collision::RectPolygonContact(e.getComponent<RectTransformComponent>().rect, polygon, m);
+            default:
+                return Collision::PolygonContact(e.getComponent<PolyTransformComponent>().polygon, polygon, m);
+            }
+        });
+}
+
+Entity* Game::GetEntity(EntityHandle handle)
+{
+    return manager.get(handle);
+}
+
+CommandBuffers& Game::Commands()
+{
+    return commands;
+}
+
+void Game::SetStaticGeometry(StaticGeometry geometry)
+{
+    staticGeometry = std::move(geometry);
+    arenaGeometry = false;
+
+    // Cached pairs may refer to colliders that no longer exist
+    broadphase.Clear();
+    broadphase.SetStaticGeometry(&staticGeometry);
+    contactCache.Clear();
+}
+
+const std::vector<ContactEvent>& Game::ContactEvents() const
+{
+    return contactEvents;
+}
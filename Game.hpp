@@ -5,9 +5,29 @@
 #include "Timer.hpp"
 #include "Audio.hpp"
 #include "ECS.hpp"
+#include "CommandBuffer.hpp"
 #include "Components.hpp"
 #include "Vector2D.hpp"
 #include "Collision.hpp"
+#include "Replay.hpp"
+#include "Random.hpp"
+#include "Snapshot.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include "Observables.hpp"
+#include "Profiler.hpp"
+#include "PerfOverlay.hpp"
+#include "ContactSolver.hpp"
+#include "ContactCache.hpp"
+#include "Broadphase.hpp"
+#include "StaticGeometry.hpp"
+#include "Camera.hpp"
+#include "WorldChunks.hpp"
+#include "BarnesHut.hpp"
+#include "HardDiskEngine.hpp"
+#include "Integrator.hpp"
+#include "Ray.hpp"
+#include "SceneFile.hpp"
 
 class Game
 {
@@ -18,6 +38,29 @@ public:
 
 	void Run();
 
+	// Both switch the timer to a fixed step so runs are reproducible, keyframes carry the world state
+	bool StartRecording(std::string path, uint64_t seed = DEFAULT_SEED);
+	bool StartReplay(std::string path, unsigned int seekTick = 0);
+	void SeekReplay(unsigned int target);
+
+	bool SaveSnapshot(std::string path);
+	bool LoadSnapshot(std::string path);
+
+	// Replaces the bodies with a scene, either a snapshot or the text format in SceneFile.hpp
+	bool LoadScene(std::string path);
+
+	// Builds a batch of bodies in one pass, storage is reserved once for the whole batch. Given
+	// ids, body i gets back entity id ids[i] instead of a new one.
+	void SpawnDisks(const DiskRecord* records, size_t count, const uint32_t* ids = nullptr);
+	void SpawnRects(const RectRecord* records, size_t count, const uint32_t* ids = nullptr);
+	void SpawnPolys(const PolyRecord* records, size_t count, const VertexRecord* vertices, const uint32_t* ids = nullptr);
+
+	// Contacts that began, persisted or ended during the last step
+	const std::vector<ContactEvent>& ContactEvents() const;
+
+	// Replaces the level's static colliders, the default is a box around the screen
+	void SetStaticGeometry(StaticGeometry geometry);
+
 	enum groupLabels : std::size_t
 	{
 		polyGroup,
@@ -25,11 +68,109 @@ public:
 		rectGroup
 	};
 
+	// Stored in snapshot flags
+	enum worldFlags : uint32_t
+	{
+		nBodyGravityFlag = 1u << 0,
+		eventDrivenFlag = 1u << 1,
+
+		// Two bits holding the integrator scheme
+		integratorFlags = 3u << 2
+	};
+
+	// Nearest body or static collider along each ray, rays are cast in parallel. Bodies are as of
+	// the last collision step and are left out between EarlyUpdate's refresh and the next step.
+	void Raycast(const Ray* rays, size_t count, RayHit* hits);
+	RayHit Raycast(const Ray& ray);
+
+	// Bodies whose shape overlaps the region. out is cleared and refilled, so a buffer kept by the
+	// caller stops allocating once it has grown. Same body lifetime as Raycast, main thread only.
+	void QueryAABB(const BoundingBox& box, std::vector<EntityHandle>& out);
+	void QueryRadius(Vector2D centre, float radius, std::vector<EntityHandle>& out);
+	void QueryPolygon(const Polygon& polygon, std::vector<EntityHandle>& out);
+
+	// nullptr once the entity has been destroyed
+	Entity* GetEntity(EntityHandle handle);
+
+	// Structural changes recorded by parallel phases, one buffer per chunk. They are applied
+	// in chunk order at the start of the next tick, before the replay and the manager refresh.
+	CommandBuffers& Commands();
+
+	// Runs fixed steps back to back until the next frame is due instead of one step per frame,
+	// toggled with F4. Fast forward simulates ahead without rendering, F9 skips FAST_FORWARD_SECS.
+	void SetTurbo(bool enabled);
+	void FastForward(float seconds);
+
+	// Mutual attraction between disks, toggled with G
+	void SetNBodyGravity(bool enabled);
+	BarnesHut& GravityTree();
+
+	// Runs a gas of disks in the default arena on the event-driven engine instead of stepping it,
+	// toggled with H. Collisions are exact and elastic and disks fly free of gravity. False when the
+	// world has other bodies, n-body gravity or custom static geometry.
+	bool SetEventDriven(bool enabled);
+	HardDiskEngine& HardDisks();
+
+	// Scheme used by every body, cycled with I
+	void SetIntegrator(Integrator::SCHEME scheme);
+	Integrator& Integration();
+
 private:
 
+	static const uint64_t DEFAULT_SEED = 0x5eed5eedULL;
+	static const uint32_t INTEGRATOR_SHIFT = 2;
+
 	const int FRAME_RATE = 120;
 	const float FRAME_SECS = 1.0f / FRAME_RATE;
 
+	// Ticks between observable samples while logging
+	const int OBSERVABLE_INTERVAL = 12;
+
+	// Normal speed at which an impact plays at full volume
+	const float IMPACT_SPEED = 400.0f;
+
+	// Disks stay a perfectly elastic gas, boxes and polygons settle into piles
+	const float DISK_RESTITUTION = 1.0f;
+	const float DISK_FRICTION = 0.0f;
+	const float RECT_RESTITUTION = 0.3f;
+	const float RECT_FRICTION = 0.5f;
+	const float POLY_RESTITUTION = 0.2f;
+	const float POLY_FRICTION = 0.5f;
+
+	// Walls never add bounce, so disks reflect elastically and boxes come to rest
+	const float WALL_RESTITUTION = 0.0f;
+	const float WALL_FRICTION = 0.5f;
+	const float WALL_THICKNESS = 200.0f;
+	const SDL_Color STATIC_COLOUR = { 0x80, 0x80, 0x80, 0xff };
+
+	// Disks drifting further than this fraction of their radius in a step are swept for impacts
+	const float CCD_FRACTION = 0.5f;
+
+	// Impacts resolved per swept disk and step, anything further is left to the contact solver
+	const int CCD_MAX_IMPACTS = 4;
+
+	// World units added around the view when culling, covers movement since the broadphase ran
+	const float CULL_MARGIN = 32.0f;
+
+	// Rays per parallel chunk, a cast is a few hundred slab tests at most
+	const size_t RAY_CHUNK = 32;
+
+	// Bodies per parallel chunk when looking for escaped ones, each is a bounds check
+	const size_t CULL_CHUNK = 256;
+
+	// Turbo renders at this interval and spends the rest of it stepping
+	const float TURBO_FRAME_SECS = 1.0f / 30.0f;
+	const float FAST_FORWARD_SECS = 10.0f;
+
+	// Steps between event pumps while fast forwarding, so the window is not reported as hung
+	const unsigned int FAST_FORWARD_PUMP = 256;
+
+	// Longest frame the camera moves for, so a stall or a fast forward does not throw the view
+	const float MAX_CAMERA_SECS = 0.1f;
+
+	// Chunks this far outside the view keep simulating, so bodies just off screen do not freeze
+	const float STREAM_MARGIN = 512.0f;
+
 	static Game* instance;
 
 	bool quit;
@@ -39,8 +180,97 @@ private:
 	Input* input;
 	Audio* audio;
 	Collision* collision;
+	Replay* replay;
+	ThreadPool* threadPool;
+
+	Random random;
+	InputFrame inputFrame;
+	SnapshotWriter keyframeSnapshot;
+
+	unsigned int tick;
+	double simulationTime;
+
+	bool turbo;
+
+	PerfOverlay overlay;
+	FrameCounters counters;
 
-	SDL_Rect viewRect;
+	Observables observables;
+	ObservableWriter observableWriter;
+	ObservableSample observableSample;
+	int observableTicks;
+	double observableTime;
+
+	SFXHandle impactSFX;
+
+	StaticGeometry staticGeometry;
+	Broadphase broadphase;
+	ContactCache contactCache;
+	ContactSolver solver;
+
+	std::vector<BroadphaseProxy> proxies;
+	std::vector<Entity*> bodyEntities;
+
+	// False once the entities above may have been freed
+	bool queryBodiesValid;
+	std::vector<int> queryCandidates;
+	std::vector<EntityHandle> spawnOverlaps;
+	std::vector<int> fastDisks;
+	std::vector<int> ccdStatic;
+	std::vector<SolverBody> solverBodies;
+	std::vector<Contact> contacts;
+	std::vector<ContactEvent> contactEvents;
+
+	Camera camera;
+	Uint64 cameraCounter;
+	std::vector<int> visibleBodies;
+	std::vector<int> visibleStatic;
+
+	Integrator integrator;
+
+	// Polygons, disks then rects, the same layout as the solver bodies. Laid out again only when
+	// the groups change, and between IntegrateBegin and IntegrateEnd the velocities live here.
+	MotionArrays motion;
+	std::vector<Entity*> motionEntities;
+
+	// Whether ax and ay still hold the accelerations from the end of the last step
+	bool motionAccelerations;
+
+	bool nBodyGravity;
+	BarnesHut gravityTree;
+	std::vector<Vector2D> gravityPositions;
+	std::vector<float> gravityMasses;
+	std::vector<Vector2D> gravityAccelerations;
+
+	CommandBuffers commands;
+
+	// Interior of the default arena, false once SetStaticGeometry replaced it
+	BoundingBox arenaBounds;
+	bool arenaGeometry;
+
+	bool eventDriven;
+	HardDiskEngine hardDisks;
+
+	// Disks as last loaded or written back, so changes made outside the engine can be picked up
+	std::vector<Entity*> hardDiskEntities;
+	std::vector<Vector2D> hardDiskPositions;
+	std::vector<Vector2D> hardDiskVelocities;
+	std::vector<float> hardDiskRadii;
+	std::vector<float> hardDiskMasses;
+
+	WorldChunks chunks;
+	SnapshotWriter chunkWriter;
+	std::vector<char> chunkBuffer;
+	std::vector<uint64_t> chunkKeys;
+
+	// Bodies leaving the active region this tick, tagged with their chunk key and group
+	struct StreamedBody
+	{
+		uint64_t key;
+		std::size_t group;
+		Entity* entity;
+	};
+	std::vector<StreamedBody> streamedBodies;
 
 	Timer* timer;
 
@@ -51,13 +281,79 @@ private:
 	void LateUpdate();
 	void Render();
 
+	void Step();
+	void ResetWorld();
+	void StopReplay();
+
+	void CountBodies();
+
+	void ToggleObservableLog(std::string path);
+	void SampleObservables();
+
+	// Bottom of the world, the datum for potential energy
+	float FloorHeight();
+
+	Entity& SpawnDisk(Vector2D centre, float radius, float density, Vector2D velocity = VEC_ZERO);
+	Entity& SpawnRect(Vector2D position, Vector2D size, float density, Vector2D velocity = VEC_ZERO);
+	Entity& SpawnPoly(const Polygon& polygon, float density, SDL_Color colour, Vector2D velocity = VEC_ZERO);
+
+	void CaptureSnapshot(SnapshotWriter& snapshot);
+	void RestoreSnapshot(const SnapshotView& snapshot);
+
+	// Contact cache, broadphase and engine, so a restored world steps exactly like the captured one
+	void CaptureSolverState(SnapshotWriter& snapshot);
+	void RestoreSolverState(const SnapshotView& snapshot);
+
+	void CaptureBody(SnapshotWriter& snapshot, Entity& entity, std::size_t group);
+	void SpawnBodies(const SnapshotView& snapshot);
+
+	// Restores chunks that became active and stores bodies that left the active region
+	void UpdateStreaming();
+	void StoreChunk(uint64_t key, const StreamedBody* first, const StreamedBody* last);
+
 	Game();
 	~Game();
 
+	// The integrator's stages. Begin gathers the velocities into the motion arrays, the contacts
+	// solve on them there and End scatters them back, once each per step.
+	void IntegrateBegin();
+	void IntegrateForces();
+	void IntegrateEnd();
+
+	// Whether the motion arrays still follow the groups, and laying them out again when not. True
+	// when LayOutMotion did, which drops the accelerations.
+	bool MotionLaidOut() const;
+	bool LayOutMotion();
+	void GatherMotion();
+	void TranslateMotion();
+	void ScatterMotion(bool translate);
+
+	// Queues a destroy for bodies that left the arena or stopped being finite
+	void CullEscapedBodies();
+
+	// Fills the accelerations in the motion arrays
+	void Accelerations();
+	void AddNBodyGravity();
+
+	bool EventDrivenAllowed();
+	void StepHardDisks();
+
+	// Whether the engine's disks are still the disk group, and taking them on as they are now
+	bool HardDisksTracked();
+	void TrackHardDisks();
+
+	bool RaycastBody(int proxy, const Ray& ray, float& distance, Vector2D& normal);
+
+	// Broadphase candidates for the box whose exact shape passes the test
+	template <typename F> void QueryBodies(const BoundingBox& box, std::vector<EntityHandle>& out, F overlaps);
+
 	void HandleCollision();
-	void HandlePolyCollision();
-	void HandleDiskCollision();
-	void HandleRectCollision();
+
+	// Sub-steps fast disks through their impacts with other disks and static geometry
+	void SweepFastDisks(float dt);
+	void UpdateContacts();
+	bool Narrowphase(const BroadphasePair& pair, Manifold& manifold);
+	void AddWallImpulse(int body, float impulse);
 
 };
 
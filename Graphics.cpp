@@ -1,3 +1,4 @@
+#include <cmath>
 #include "Graphics.hpp"
 
 Graphics* Graphics::instance = nullptr;
@@ -29,6 +30,7 @@ bool Graphics::HasInitialised()
 Graphics::Graphics()
 {
 	renderer = nullptr;
+	ResetView();
 	initialised = Init();
 }
 
@@ -70,6 +72,7 @@ bool Graphics::Init()
 		return false;
 	}
 	SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 
 	// Start image library, error check
 	int imgflags = IMG_INIT_PNG;
@@ -129,6 +132,36 @@ SDL_Texture* Graphics::LoadText(TTF_Font* font, std::string text, SDL_Color colo
 	return tex;
 }
 
+void Graphics::SetView(Vector2D origin, float scale)
+{
+	viewOrigin = origin;
+	viewScale = scale;
+	viewSet = true;
+}
+
+void Graphics::ResetView()
+{
+	viewOrigin = VEC_ZERO;
+	viewScale = 1.0f;
+	viewSet = false;
+}
+
+Vector2D Graphics::ToScreen(Vector2D p) const
+{
+	return viewScale * (p - viewOrigin);
+}
+
+SDL_Rect Graphics::ToScreen(const SDL_Rect& rect) const
+{
+	// Transform both corners so neighbouring rectangles still tile without gaps
+	Vector2D min = ToScreen(Vector2D(static_cast<float>(rect.x), static_cast<float>(rect.y)));
+	Vector2D max = ToScreen(Vector2D(static_cast<float>(rect.x + rect.w), static_cast<float>(rect.y + rect.h)));
+
+	int x = static_cast<int>(std::floor(min.x));
+	int y = static_cast<int>(std::floor(min.y));
+	return { x, y, static_cast<int>(std::floor(max.x)) - x, static_cast<int>(std::floor(max.y)) - y };
+}
+
 void Graphics::ClearRenderer()
 {
 	SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xff);
@@ -142,22 +175,60 @@ void Graphics::Render()
 
 void Graphics::DrawTexture(SDL_Texture* tex, SDL_Rect* sRect, SDL_Rect* dRect, float rot, SDL_RendererFlip flip)
 {
+	if (viewSet && dRect != nullptr)
+	{
+		SDL_Rect view = ToScreen(*dRect);
+		SDL_RenderCopyEx(renderer, tex, sRect, &view, rot, NULL, flip);
+		return;
+	}
+
 	SDL_RenderCopyEx(renderer, tex, sRect, dRect, rot, NULL, flip);
 }
 
 void Graphics::DrawRectangle(SDL_Color colour, SDL_Rect* rect)
 {
 	SDL_SetRenderDrawColor(renderer, colour.r, colour.g, colour.b, colour.a);
+
+	if (viewSet && rect != nullptr)
+	{
+		SDL_Rect view = ToScreen(*rect);
+		SDL_RenderFillRect(renderer, &view);
+		return;
+	}
+
 	SDL_RenderFillRect(renderer, rect);
 }
 
+void Graphics::DrawRectangles(SDL_Color colour, const SDL_Rect* rects, int count)
+{
+	if (count <= 0)
+		return;
+
+	SDL_SetRenderDrawColor(renderer, colour.r, colour.g, colour.b, colour.a);
+
+	if (viewSet)
+	{
+		viewRects.resize(count);
+		for (int i = 0; i < count; i++)
+			viewRects[i] = ToScreen(rects[i]);
+
+		SDL_RenderFillRects(renderer, viewRects.data(), count);
+		return;
+	}
+
+	SDL_RenderFillRects(renderer, rects, count);
+}
+
 void Graphics::DrawLine(SDL_Color colour, Vector2D start, Vector2D end)
 {
 	SDL_SetRenderDrawColor(renderer, colour.r, colour.g, colour.b, colour.a);
+
+	start = ToScreen(start);
+	end = ToScreen(end);
 	SDL_RenderDrawLine(renderer, (int)start.x, (int)start.y, (int)end.x, (int)end.y);
 }
 
-void Graphics::DrawPolygon(SDL_Color colour, Polygon poly)
+void Graphics::DrawPolygon(SDL_Color colour, const Polygon& poly)
 {
 	SDL_SetRenderDrawColor(renderer, colour.r, colour.g, colour.b, colour.a);
 
@@ -165,7 +236,8 @@ void Graphics::DrawPolygon(SDL_Color colour, Polygon poly)
 
 	for (int i = 0; i < n; i++)
 	{
-		SDL_RenderDrawLine(renderer, poly.vertices[i].x, poly.vertices[i].y, poly.vertices[i + 1].x, poly.vertices[i + 1].y);
+		Vector2D start = ToScreen(poly.centre + poly.Vertex(i));
+		Vector2D end = ToScreen(poly.centre + poly.Vertex(i + 1));
+		SDL_RenderDrawLine(renderer, (int)start.x, (int)start.y, (int)end.x, (int)end.y);
 	}
 }
-
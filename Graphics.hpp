@@ -6,6 +6,7 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
+#include <vector>
 #include "Polygon.hpp"
 
 class Graphics
@@ -24,8 +25,14 @@ public:
 	SDL_Texture* LoadText(TTF_Font* font, std::string text, SDL_Color colour);
 
 	void DrawRectangle(SDL_Color colour, SDL_Rect* rect);
+	void DrawRectangles(SDL_Color colour, const SDL_Rect* rects, int count);
 	void DrawLine(SDL_Color colour, Vector2D start, Vector2D end);
-	void DrawPolygon(SDL_Color colour, Polygon poly);
+	void DrawPolygon(SDL_Color colour, const Polygon& poly);
+
+	// Every Draw call maps world positions to screen as (p - origin) * scale until ResetView
+	void SetView(Vector2D origin, float scale);
+	void ResetView();
+	Vector2D ToScreen(Vector2D p) const;
 
 	void ClearRenderer();
 	void Render();
@@ -38,6 +45,13 @@ private:
 	static Graphics* instance;
 	static bool initialised;
 
+	Vector2D viewOrigin;
+	float viewScale;
+	bool viewSet;
+	std::vector<SDL_Rect> viewRects;
+
+	SDL_Rect ToScreen(const SDL_Rect& rect) const;
+
 	Graphics();
 	~Graphics();
 
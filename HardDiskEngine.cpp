@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "HardDiskEngine.hpp"
+
+namespace
+{
+	const double NEVER = INFINITY;
+
+	// Time until p moving at v reaches target, only asked while moving towards it. A disk already
+	// past the target, from rounding or a stepped start, meets it immediately.
+	double Crossing(double p, double v, double target)
+	{
+		return std::max((target - p) / v, 0.0);
+	}
+
+	template <typename T> void Put(std::vector<char>& out, const T& value)
+	{
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	template <typename T> void PutArray(std::vector<char>& out, const std::vector<T>& items)
+	{
+		Put(out, static_cast<uint64_t>(items.size()));
+		const char* bytes = reinterpret_cast<const char*>(items.data());
+		out.insert(out.end(), bytes, bytes + items.size() * sizeof(T));
+	}
+
+	// Reads advance data and fail rather than run past end
+	template <typename T> bool Get(const char*& data, const char* end, T& value)
+	{
+		if (static_cast<size_t>(end - data) < sizeof(T))
+			return false;
+
+		memcpy(&value, data, sizeof(T));
+		data += sizeof(T);
+		return true;
+	}
+
+	template <typename T> bool GetArray(const char*& data, const char* end, std::vector<T>& items)
+	{
+		uint64_t count;
+		if (!Get(data, end, count) || count > static_cast<size_t>(end - data) / sizeof(T))
+			return false;
+
+		items.resize(static_cast<size_t>(count));
+		if (count != 0)
+			memcpy(items.data(), data, items.size() * sizeof(T));
+		data += items.size() * sizeof(T);
+		return true;
+	}
+}
+
+void HardDiskEngine::Load(const Vector2D* positions, const Vector2D* velocities, const float* radii, const float* masses,
+	size_t count, const BoundingBox& containerIn)
+{
+	now = 0.0;
+	sequence = 0;
+	events = 0;
+	container = containerIn;
+
+	x.resize(count);
+	y.resize(count);
+	vx.resize(count);
+	vy.resize(count);
+	time.assign(count, 0.0);
+	radius.resize(count);
+	mass.resize(count);
+	wallImpulse.assign(count, 0.0);
+	counts.assign(count, 0u);
+
+	double largest = 0.0;
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = positions[i].x;
+		y[i] = positions[i].y;
+		vx[i] = velocities[i].x;
+		vy[i] = velocities[i].y;
+		radius[i] = radii[i];
+		mass[i] = masses[i];
+		largest = std::max(largest, 2.0 * radius[i]);
+	}
+
+	// Around one disk per cell, but never narrower than a diameter so touching disks are neighbours
+	double width = std::max(static_cast<double>(container.max.x - container.min.x), 1.0);
+	double height = std::max(static_cast<double>(container.max.y - container.min.y), 1.0);
+	double spacing = std::sqrt(width * height / std::max<size_t>(count, 1));
+	double size = std::max(largest, spacing);
+
+	origin = container.min;
+	columns = std::max(1, static_cast<int>(width / size));
+	rows = std::max(1, static_cast<int>(height / size));
+	cellSize = std::max(width / columns, height / rows);
+
+	cells.assign(columns * rows, std::vector<int>());
+	cell.resize(count);
+	cellSlot.resize(count);
+
+	for (int i = 0; i < static_cast<int>(count); i++)
+	{
+		int c = CellOf(i);
+		cell[i] = c;
+		cellSlot[i] = static_cast<int>(cells[c].size());
+		cells[c].push_back(i);
+	}
+
+	Rebuild();
+}
+
+void HardDiskEngine::Set(size_t index, const Vector2D& position, const Vector2D& velocity)
+{
+	int i = static_cast<int>(index);
+
+	time[i] = now;
+	x[i] = position.x;
+	y[i] = position.y;
+	vx[i] = velocity.x;
+	vy[i] = velocity.y;
+
+	// Every prediction involving the disk is now stale
+	counts[i]++;
+
+	int c = CellOf(i);
+	if (c != cell[i])
+		MoveToCell(i, c);
+
+	Predict(i);
+}
+
+void HardDiskEngine::Advance(double duration)
+{
+	double end = now + duration;
+
+	while (!queue.empty() && queue.front().time <= end)
+	{
+		std::pop_heap(queue.begin(), queue.end(), Later());
+		Event e = queue.back();
+		queue.pop_back();
+
+		if (e.countA != counts[e.a] || (e.type == pairEvent && e.countB != counts[e.b]))
+			continue;
+
+		now = e.time;
+		events++;
+
+		switch (e.type)
+		{
+		case pairEvent:
+			Update(e.a);
+			Update(e.b);
+			Collide(e.a, e.b);
+			counts[e.a]++;
+			counts[e.b]++;
+			Predict(e.a);
+			Predict(e.b);
+			break;
+
+		case wallEvent:
+			Update(e.a);
+			Reflect(e.a, e.b);
+			counts[e.a]++;
+			Predict(e.a);
+			break;
+
+		case cellEvent:
+		{
+			// Stepped by index rather than recomputed from the position, which sits on the boundary
+			int c = cell[e.a];
+			int step[] = { -1, 1, -columns, columns };
+			Update(e.a);
+			MoveToCell(e.a, c + step[e.b]);
+			counts[e.a]++;
+			Predict(e.a);
+			break;
+		}
+		}
+
+		if (queue.size() > static_cast<size_t>(REBUILD_FACTOR) * x.size() + 1024)
+			Rebuild();
+	}
+
+	now = end;
+	for (int i = 0; i < static_cast<int>(x.size()); i++)
+		Update(i);
+}
+
+size_t HardDiskEngine::Count() const
+{
+	return x.size();
+}
+
+double HardDiskEngine::Time() const
+{
+	return now;
+}
+
+Vector2D HardDiskEngine::Position(size_t i) const
+{
+	double dt = now - time[i];
+	return Vector2D(static_cast<float>(x[i] + vx[i] * dt), static_cast<float>(y[i] + vy[i] * dt));
+}
+
+Vector2D HardDiskEngine::Velocity(size_t i) const
+{
+	return Vector2D(static_cast<float>(vx[i]), static_cast<float>(vy[i]));
+}
+
+float HardDiskEngine::TakeWallImpulse(size_t i)
+{
+	float impulse = static_cast<float>(wallImpulse[i]);
+	wallImpulse[i] = 0.0;
+	return impulse;
+}
+
+uint64_t HardDiskEngine::EventCount() const
+{
+	return events;
+}
+
+void HardDiskEngine::Serialise(std::vector<char>& out) const
+{
+	out.clear();
+	Put(out, now);
+	Put(out, sequence);
+	Put(out, events);
+	Put(out, container);
+	Put(out, origin);
+	Put(out, cellSize);
+	Put(out, columns);
+	Put(out, rows);
+
+	PutArray(out, x);
+	PutArray(out, y);
+	PutArray(out, vx);
+	PutArray(out, vy);
+	PutArray(out, time);
+	PutArray(out, radius);
+	PutArray(out, mass);
+	PutArray(out, wallImpulse);
+	PutArray(out, counts);
+	PutArray(out, cell);
+	PutArray(out, cellSlot);
+
+	for (const auto& members : cells)
+		PutArray(out, members);
+
+	PutArray(out, queue);
+}
+
+bool HardDiskEngine::Deserialise(const char* data, size_t size)
+{
+	const char* end = data + size;
+
+	bool read = Get(data, end, now) && Get(data, end, sequence) && Get(data, end, events) && Get(data, end, container)
+		&& Get(data, end, origin) && Get(data, end, cellSize) && Get(data, end, columns) && Get(data, end, rows)
+		&& GetArray(data, end, x) && GetArray(data, end, y) && GetArray(data, end, vx) && GetArray(data, end, vy)
+		&& GetArray(data, end, time) && GetArray(data, end, radius) && GetArray(data, end, mass)
+		&& GetArray(data, end, wallImpulse) && GetArray(data, end, counts) && GetArray(data, end, cell)
+		&& GetArray(data, end, cellSlot);
+
+	// Every cell takes at least its member count, which bounds the grid before it is allocated
+	size_t n = x.size();
+	read = read && columns > 0 && rows > 0 && static_cast<uint64_t>(columns) * rows <= static_cast<size_t>(end - data) / sizeof(uint64_t);
+	if (read)
+	{
+		cells.assign(static_cast<size_t>(columns) * rows, std::vector<int>());
+		for (auto& members : cells)
+			read = read && GetArray(data, end, members);
+	}
+	read = read && GetArray(data, end, queue) && data == end;
+
+	// Every index has to stay in range, the event loop trusts them
+	read = read && y.size() == n && vx.size() == n && vy.size() == n && time.size() == n && radius.size() == n
+		&& mass.size() == n && wallImpulse.size() == n && counts.size() == n && cell.size() == n && cellSlot.size() == n;
+
+	for (size_t i = 0; read && i < n; i++)
+	{
+		read = cell[i] >= 0 && static_cast<size_t>(cell[i]) < cells.size() && cellSlot[i] >= 0
+			&& static_cast<size_t>(cellSlot[i]) < cells[cell[i]].size() && cells[cell[i]][cellSlot[i]] == static_cast<int>(i);
+	}
+
+	for (size_t i = 0; read && i < queue.size(); i++)
+	{
+		const Event& e = queue[i];
+		read = e.a >= 0 && static_cast<size_t>(e.a) < n && e.b >= 0
+			&& (e.type == pairEvent ? static_cast<size_t>(e.b) < n : (e.type == wallEvent || e.type == cellEvent) && e.b <= bottom);
+	}
+
+	if (!read)
+	{
+		*this = HardDiskEngine();
+		return false;
+	}
+
+	// Leaves a heap written by Serialise as it was, and makes anything else one
+	std::make_heap(queue.begin(), queue.end(), Later());
+	return true;
+}
+
+void HardDiskEngine::Update(int i)
+{
+	double dt = now - time[i];
+	x[i] += vx[i] * dt;
+	y[i] += vy[i] * dt;
+	time[i] = now;
+}
+
+void HardDiskEngine::Predict(int i)
+{
+	// Only the first wall and the first cell boundary matter, the disk will have changed course or
+	// been predicted again by then
+	double r = radius[i];
+	double walls[] = {
+		vx[i] < 0.0 ? Crossing(x[i], vx[i], container.min.x + r) : NEVER,
+		vx[i] > 0.0 ? Crossing(x[i], vx[i], container.max.x - r) : NEVER,
+		vy[i] < 0.0 ? Crossing(y[i], vy[i], container.min.y + r) : NEVER,
+		vy[i] > 0.0 ? Crossing(y[i], vy[i], container.max.y - r) : NEVER };
+
+	int wall = static_cast<int>(std::min_element(walls, walls + 4) - walls);
+	if (walls[wall] < NEVER)
+		Push(now + walls[wall], wallEvent, i, wall);
+
+	// The outer boundaries of the grid are left to the walls
+	int cx = cell[i] % columns;
+	int cy = cell[i] / columns;
+	double boundaries[] = {
+		vx[i] < 0.0 && cx > 0 ? Crossing(x[i], vx[i], origin.x + cx * cellSize) : NEVER,
+		vx[i] > 0.0 && cx < columns - 1 ? Crossing(x[i], vx[i], origin.x + (cx + 1) * cellSize) : NEVER,
+		vy[i] < 0.0 && cy > 0 ? Crossing(y[i], vy[i], origin.y + cy * cellSize) : NEVER,
+		vy[i] > 0.0 && cy < rows - 1 ? Crossing(y[i], vy[i], origin.y + (cy + 1) * cellSize) : NEVER };
+
+	int boundary = static_cast<int>(std::min_element(boundaries, boundaries + 4) - boundaries);
+	if (boundaries[boundary] < NEVER)
+		Push(now + boundaries[boundary], cellEvent, i, boundary);
+
+	for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, rows - 1); ny++)
+	{
+		for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, columns - 1); nx++)
+		{
+			for (int j : cells[ny * columns + nx])
+			{
+				if (j != i)
+					PredictPair(i, j);
+			}
+		}
+	}
+}
+
+void HardDiskEngine::PredictPair(int i, int j)
+{
+	// Relative motion is a straight line, so contact solves |dr + dv t| = ri + rj
+	double dtj = now - time[j];
+	double dx = x[j] + vx[j] * dtj - x[i];
+	double dy = y[j] + vy[j] * dtj - y[i];
+	double dvx = vx[j] - vx[i];
+	double dvy = vy[j] - vy[i];
+
+	double b = dx * dvx + dy * dvy;
+	if (b >= 0.0)
+		return;
+
+	double sigma = radius[i] + radius[j];
+	double distanceSquared = dx * dx + dy * dy;
+	double speedSquared = dvx * dvx + dvy * dvy;
+
+	// Overlapping and still approaching, left over from a stepped start, so push them apart now
+	if (distanceSquared < sigma * sigma)
+	{
+		Push(now, pairEvent, i, j);
+		return;
+	}
+
+	double discriminant = b * b - speedSquared * (distanceSquared - sigma * sigma);
+	if (discriminant < 0.0)
+		return;
+
+	Push(now - (b + std::sqrt(discriminant)) / speedSquared, pairEvent, i, j);
+}
+
+void HardDiskEngine::Push(double t, EVENT type, int a, int b)
+{
+	Event e;
+	e.time = t;
+	e.sequence = sequence++;
+	e.type = type;
+	e.a = a;
+	e.b = b;
+	e.countA = counts[a];
+	e.countB = type == pairEvent ? counts[b] : 0u;
+	queue.push_back(e);
+	std::push_heap(queue.begin(), queue.end(), Later());
+}
+
+void HardDiskEngine::Rebuild()
+{
+	queue.clear();
+
+	// A pair is predicted from both ends, whichever is popped second is stale by then
+	for (int i = 0; i < static_cast<int>(x.size()); i++)
+		Update(i);
+
+	for (int i = 0; i < static_cast<int>(x.size()); i++)
+		Predict(i);
+}
+
+int HardDiskEngine::CellOf(int i) const
+{
+	int cx = static_cast<int>(std::floor((x[i] - origin.x) / cellSize));
+	int cy = static_cast<int>(std::floor((y[i] - origin.y) / cellSize));
+	cx = std::min(std::max(cx, 0), columns - 1);
+	cy = std::min(std::max(cy, 0), rows - 1);
+	return cy * columns + cx;
+}
+
+void HardDiskEngine::MoveToCell(int i, int c)
+{
+	// Swap and pop out of the old cell
+	std::vector<int>& from = cells[cell[i]];
+	int last = from.back();
+	from[cellSlot[i]] = last;
+	cellSlot[last] = cellSlot[i];
+	from.pop_back();
+
+	cell[i] = c;
+	cellSlot[i] = static_cast<int>(cells[c].size());
+	cells[c].push_back(i);
+}
+
+void HardDiskEngine::Collide(int i, int j)
+{
+	double dx = x[j] - x[i];
+	double dy = y[j] - y[i];
+	double distance = std::sqrt(dx * dx + dy * dy);
+	if (distance == 0.0)
+		return;
+
+	double nx = dx / distance;
+	double ny = dy / distance;
+	double approach = (vx[j] - vx[i]) * nx + (vy[j] - vy[i]) * ny;
+
+	// Equal and opposite impulse along the line of centres reverses the approach speed
+	double impulse = 2.0 * mass[i] * mass[j] * approach / (mass[i] + mass[j]);
+	vx[i] += impulse / mass[i] * nx;
+	vy[i] += impulse / mass[i] * ny;
+	vx[j] -= impulse / mass[j] * nx;
+	vy[j] -= impulse / mass[j] * ny;
+}
+
+void HardDiskEngine::Reflect(int i, int side)
+{
+	double& v = side == left || side == right ? vx[i] : vy[i];
+	wallImpulse[i] += 2.0 * mass[i] * std::abs(v);
+	v = -v;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Vector2D.hpp"
+#include "BoundingBox.hpp"
+
+// Event-driven simulation of perfectly elastic hard disks in a box. Disks fly in straight lines
+// between collisions, so instead of stepping the engine predicts when each pair or wall will
+// next meet, keeps the predictions in a priority queue and jumps from one event to the next.
+// A uniform grid with cells at least a diameter wide limits pair predictions to neighbouring
+// cells, and a disk crossing into another cell is an event of its own. Predictions made stale
+// by a later collision are not removed, they are recognised by the disk's collision count
+// when popped and skipped.
+class HardDiskEngine
+{
+public:
+
+	// The queue is rebuilt from scratch when stale events outnumber disks by this much
+	static const int REBUILD_FACTOR = 32;
+
+	// Replaces every disk and restarts the clock at zero. Disks should lie inside the container.
+	void Load(const Vector2D* positions, const Vector2D* velocities, const float* radii, const float* masses,
+		size_t count, const BoundingBox& container);
+
+	// Changes one disk's state at the current time, for bodies moved from outside the engine
+	void Set(size_t i, const Vector2D& position, const Vector2D& velocity);
+
+	// Processes every event up to now + duration and moves all disks to that time
+	void Advance(double duration);
+
+	size_t Count() const;
+	double Time() const;
+
+	Vector2D Position(size_t i) const;
+	Vector2D Velocity(size_t i) const;
+
+	// Impulse given to the walls by disk i since the last call
+	float TakeWallImpulse(size_t i);
+
+	// Collisions and cell crossings processed since Load, stale predictions not included
+	uint64_t EventCount() const;
+
+	// The whole engine including pending predictions, so a restored engine processes the same
+	// events in the same order. Only meant to be read back by the same build. Deserialise
+	// returns false and leaves the engine empty if the bytes do not describe a valid state.
+	void Serialise(std::vector<char>& out) const;
+	bool Deserialise(const char* data, size_t size);
+
+private:
+
+	enum EVENT { pairEvent = 0, wallEvent, cellEvent };
+	enum SIDE { left = 0, right, top, bottom };
+
+	struct Event
+	{
+		double time;
+		uint64_t sequence;
+
+		EVENT type;
+		int a;
+
+		// Other disk for pairs, side of the wall or cell otherwise
+		int b;
+
+		uint32_t countA;
+		uint32_t countB;
+	};
+
+	// Earliest first, ties in the order they were predicted so runs are reproducible
+	struct Later
+	{
+		bool operator()(const Event& x, const Event& y) const
+		{
+			return x.time > y.time || (x.time == y.time && x.sequence > y.sequence);
+		}
+	};
+
+	double now = 0.0;
+	uint64_t sequence = 0;
+	uint64_t events = 0;
+
+	// Kept in double so energy is conserved to rounding over millions of collisions. A disk's
+	// position is stored at its own time and moved forward only when an event involves it.
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> vx;
+	std::vector<double> vy;
+	std::vector<double> time;
+	std::vector<double> radius;
+	std::vector<double> mass;
+	std::vector<double> wallImpulse;
+	std::vector<uint32_t> counts;
+
+	BoundingBox container;
+
+	Vector2D origin;
+	double cellSize = 1.0;
+	int columns = 0;
+	int rows = 0;
+
+	// Members of every cell, and each disk's cell and index within it
+	std::vector<std::vector<int>> cells;
+	std::vector<int> cell;
+	std::vector<int> cellSlot;
+
+	// Binary heap ordered by Later, kept as a plain vector so it can be serialised
+	std::vector<Event> queue;
+
+	void Update(int i);
+	void Predict(int i);
+	void PredictPair(int i, int j);
+	void Push(double t, EVENT type, int a, int b);
+	void Rebuild();
+
+	int CellOf(int i) const;
+	void MoveToCell(int i, int c);
+
+	void Collide(int i, int j);
+	void Reflect(int i, int side);
+};
@@ -7,12 +7,26 @@ Input::Input()
 	keyboardState = SDL_GetKeyboardState(&keyLength);
 	previousKeyboardState = new Uint8[keyLength];
 	memcpy(previousKeyboardState,keyboardState, keyLength);
+
+	liveKeyboardState = keyboardState;
+	previousHotkeyState = new Uint8[keyLength];
+	memcpy(previousHotkeyState, liveKeyboardState, keyLength);
+
+	if (keyLength > SDL_NUM_SCANCODES)
+		keyLength = SDL_NUM_SCANCODES;
+
+	previousMouseState = mouseState = 0;
+	mouseX = mouseY = 0;
+	replayFrame = nullptr;
 }
 
 Input::~Input()
 {
 	delete[] previousKeyboardState;
 	previousKeyboardState = nullptr;
+
+	delete[] previousHotkeyState;
+	previousHotkeyState = nullptr;
 }
 
 
@@ -48,6 +62,16 @@ bool Input::KeyReleased(SDL_Scancode scancode)
 	return !keyboardState[scancode] && previousKeyboardState[scancode];
 }
 
+bool Input::HotkeyPressed(SDL_Scancode scancode)
+{
+	return liveKeyboardState[scancode] && !previousHotkeyState[scancode];
+}
+
+void Input::UpdateHotkeys()
+{
+	memcpy(previousHotkeyState, liveKeyboardState, keyLength);
+}
+
 bool Input::MouseButtonDown(Input::MOUSE_BUTTON button)
 {
 	Uint32 bitmask = 0;
@@ -154,6 +178,16 @@ Vector2D Input::MousePosition()
 
 void Input::Update()
 {
+	if (replayFrame != nullptr)
+	{
+		keyboardState = replayFrame->keys;
+		mouseState = replayFrame->mouseState;
+		mouseX = replayFrame->mouseX;
+		mouseY = replayFrame->mouseY;
+		return;
+	}
+
+	keyboardState = SDL_GetKeyboardState(nullptr);
 	mouseState = SDL_GetMouseState(&mouseX, &mouseY);
 }
 
@@ -161,4 +195,24 @@ void Input::UpdatePrevious()
 {
 	memcpy(previousKeyboardState, keyboardState, keyLength);
 	previousMouseState = mouseState;
+}
+
+void Input::GetFrame(InputFrame& frame)
+{
+	frame.mouseState = mouseState;
+	frame.mouseX = mouseX;
+	frame.mouseY = mouseY;
+
+	memset(frame.keys, 0, sizeof(frame.keys));
+	memcpy(frame.keys, keyboardState, keyLength);
+}
+
+void Input::SetReplayFrame(const InputFrame* frame)
+{
+	replayFrame = frame;
+}
+
+bool Input::IsReplaying()
+{
+	return replayFrame != nullptr;
 }
\ No newline at end of file
@@ -3,6 +3,21 @@
 #include <string>
 #include "Vector2D.hpp"
 
+// Everything Input reads from SDL in one tick, used for recording and replay
+struct InputFrame
+{
+	Uint32 mouseState;
+	int mouseX;
+	int mouseY;
+	Uint8 keys[SDL_NUM_SCANCODES];
+
+	// Camera view the tick ran with, filled in by the game. The mouse maps to the world through
+	// it and streaming follows it.
+	float viewX;
+	float viewY;
+	float viewZoom;
+};
+
 class Input
 {
 public:
@@ -25,6 +40,17 @@ public:
 	void Update();
 	void UpdatePrevious();
 
+	// Application hotkeys read the live keyboard even during replay, so only simulation input is
+	// replayed. They change once per frame, when UpdateHotkeys is called after they were checked.
+	bool HotkeyPressed(SDL_Scancode scancode);
+	void UpdateHotkeys();
+
+	void GetFrame(InputFrame& frame);
+
+	// While set, Update reads from this frame instead of SDL, pass nullptr to go live again
+	void SetReplayFrame(const InputFrame* frame);
+	bool IsReplaying();
+
 private:
 
 	static Input* instance;
@@ -33,11 +59,16 @@ private:
 	const Uint8* keyboardState;
 	int keyLength;
 
+	Uint8* previousHotkeyState;
+	const Uint8* liveKeyboardState;
+
 	Uint32 previousMouseState;
 	Uint32 mouseState;
 	int mouseX;
 	int mouseY;
 
+	const InputFrame* replayFrame;
+
 	Input();
 	~Input();
 
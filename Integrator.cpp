@@ -0,0 +1,114 @@
+#include "Integrator.hpp"
+#include "Vec2x8.hpp"
+
+void MotionArrays::Resize(size_t count)
+{
+	size = count;
+	size_t padded = (count + Vec2x8::WIDTH - 1) / Vec2x8::WIDTH * Vec2x8::WIDTH;
+
+	vx.assign(padded, 0.0f);
+	vy.assign(padded, 0.0f);
+	ax.assign(padded, 0.0f);
+	ay.assign(padded, 0.0f);
+	dx.assign(padded, 0.0f);
+	dy.assign(padded, 0.0f);
+	gravityScale.assign(padded, 0.0f);
+}
+
+size_t MotionArrays::Size() const
+{
+	return size;
+}
+
+const char* Integrator::Name(SCHEME scheme)
+{
+	switch (scheme)
+	{
+	case semiImplicitEuler:
+		return "SEMI-IMPLICIT EULER";
+	case velocityVerlet:
+		return "VELOCITY VERLET";
+	case leapfrog:
+		return "LEAPFROG";
+	default:
+		return "";
+	}
+}
+
+bool Integrator::Begins() const
+{
+	return scheme != semiImplicitEuler;
+}
+
+bool Integrator::Ends() const
+{
+	return scheme != velocityVerlet;
+}
+
+void Integrator::Begin(MotionArrays& m, float dt) const
+{
+	switch (scheme)
+	{
+	case velocityVerlet:
+		KickKernel(m, 0.5f * dt);
+		DriftKernel(m, dt);
+		break;
+
+	case leapfrog:
+		DriftKernel(m, 0.5f * dt);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void Integrator::Kick(MotionArrays& m, float dt) const
+{
+	KickKernel(m, scheme == velocityVerlet ? 0.5f * dt : dt);
+}
+
+void Integrator::End(MotionArrays& m, float dt) const
+{
+	switch (scheme)
+	{
+	case semiImplicitEuler:
+		DriftKernel(m, dt);
+		break;
+
+	case leapfrog:
+		DriftKernel(m, 0.5f * dt);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void Integrator::Gravity(MotionArrays& m) const
+{
+	Vec2x8 g = Vec2x8::Broadcast(gravity);
+
+	for (size_t i = 0; i < m.vx.size(); i += Vec2x8::WIDTH)
+	{
+		(g * (m.gravityScale.data() + i)).Store(m.ax.data() + i, m.ay.data() + i);
+	}
+}
+
+void Integrator::KickKernel(MotionArrays& m, float h)
+{
+	for (size_t i = 0; i < m.vx.size(); i += Vec2x8::WIDTH)
+	{
+		Vec2x8 v = Vec2x8::Load(m.vx.data() + i, m.vy.data() + i);
+		v.MulAdd(Vec2x8::Load(m.ax.data() + i, m.ay.data() + i), h);
+		v.Store(m.vx.data() + i, m.vy.data() + i);
+	}
+}
+
+void Integrator::DriftKernel(MotionArrays& m, float h)
+{
+	for (size_t i = 0; i < m.vx.size(); i += Vec2x8::WIDTH)
+	{
+		(Vec2x8::Load(m.vx.data() + i, m.vy.data() + i) * h).Store(m.dx.data() + i, m.dy.data() + i);
+	}
+}
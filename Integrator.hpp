@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include "Vector2D.hpp"
+
+// Velocity, acceleration and displacement of every body, one array per component and padded
+// to whole lanes so the kernels run eight bodies at a time without a remainder loop
+struct MotionArrays
+{
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> ax;
+	std::vector<float> ay;
+	std::vector<float> dx;
+	std::vector<float> dy;
+
+	// 1 for bodies that fall, 0 for bodies that float
+	std::vector<float> gravityScale;
+
+	// Zeroes every lane, padding lanes stay zero and are never read back
+	void Resize(size_t count);
+	size_t Size() const;
+
+	Vector2D Velocity(size_t i) const
+	{
+		return Vector2D(vx[i], vy[i]);
+	}
+
+	void SetVelocity(size_t i, Vector2D v)
+	{
+		vx[i] = v.x;
+		vy[i] = v.y;
+	}
+
+private:
+
+	size_t size = 0;
+};
+
+// Time integration split around the point where forces are evaluated and contacts solved.
+// Begin runs before the forces, Kick applies them and End runs after the contacts. Begin and
+// End leave the change of position in dx and dy instead of touching positions.
+//
+// Semi-implicit Euler kicks a full step and drifts after the contacts. Leapfrog drifts half a
+// step on each side of a full kick, the split the transform components used to do themselves.
+// Velocity Verlet kicks half a step with the accelerations at the start of the step, drifts,
+// and kicks the other half with the accelerations at the end, so contacts see the final state.
+class Integrator
+{
+public:
+
+	// Leapfrog first, so snapshots from before the choice existed load with it
+	enum SCHEME { leapfrog = 0, semiImplicitEuler, velocityVerlet, SCHEME_COUNT };
+
+	SCHEME scheme = leapfrog;
+
+	// Acceleration of every body with a gravity scale of 1, the same whatever the mass
+	Vector2D gravity = Vector2D(0.0f, 500.0f);
+
+	static const char* Name(SCHEME scheme);
+
+	// Whether Begin and End do anything, so callers can skip gathering the arrays
+	bool Begins() const;
+	bool Ends() const;
+
+	// Verlet reads ax and ay as the accelerations at the start of the step
+	void Begin(MotionArrays& m, float dt) const;
+
+	// ax and ay hold the accelerations evaluated at this point
+	void Kick(MotionArrays& m, float dt) const;
+
+	void End(MotionArrays& m, float dt) const;
+
+	// Sets ax and ay to gravity, forces from elsewhere are added on top
+	void Gravity(MotionArrays& m) const;
+
+private:
+
+	// v += a * h
+	static void KickKernel(MotionArrays& m, float h);
+
+	// d = v * h
+	static void DriftKernel(MotionArrays& m, float h);
+
+};
@@ -0,0 +1,123 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#else
+	fileDescriptor = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(std::string path)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fileDescriptor, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view != MAP_FAILED)
+	{
+		data = static_cast<const char*>(view);
+		size = static_cast<size_t>(info.st_size);
+	}
+#endif
+
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr)
+		munmap(const_cast<char*>(data), size);
+
+	if (fileDescriptor >= 0)
+		close(fileDescriptor);
+
+	fileDescriptor = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+const char* MappedFile::Data() const
+{
+	return data;
+}
+
+size_t MappedFile::Size() const
+{
+	return size;
+}
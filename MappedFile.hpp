@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped on Close or destruction
+class MappedFile
+{
+public:
+
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(std::string path);
+	void Close();
+
+	const char* Data() const;
+	size_t Size() const;
+
+private:
+
+	const char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+};
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include "Game.hpp"
+#include "Observables.hpp"
+#include "ThreadPool.hpp"
+
+namespace
+{
+	const size_t MIN_CHUNK = 1024;
+}
+
+void Observables::Partial::Merge(const Partial& p)
+{
+	kinetic.Add(p.kinetic);
+	potential.Add(p.potential);
+	momentumX.Add(p.momentumX);
+	momentumY.Add(p.momentumY);
+	wallImpulse.Add(p.wallImpulse);
+	bodies += p.bodies;
+
+	for (int i = 0; i < ObservableSample::SPEED_BINS; i++)
+		speedHistogram[i] += p.speedHistogram[i];
+}
+
+void Observables::AddBody(Partial& p, float mass, float vx, float vy, double potential)
+{
+	double speedSquared = static_cast<double>(vx) * vx + static_cast<double>(vy) * vy;
+
+	p.kinetic.Add(0.5 * mass * speedSquared);
+	p.potential.Add(potential);
+	p.momentumX.Add(static_cast<double>(mass) * vx);
+	p.momentumY.Add(static_cast<double>(mass) * vy);
+	p.bodies++;
+
+	int bin = static_cast<int>(std::sqrt(speedSquared) / maxSpeed * ObservableSample::SPEED_BINS);
+	p.speedHistogram[std::min(bin, ObservableSample::SPEED_BINS - 1)]++;
+}
+
+template <typename T> void Observables::Reduce(const std::vector<Entity*>& group)
+{
+	ThreadPool* pool = ThreadPool::GetInstance();
+
+	partials.assign(pool->ChunkCount(group.size(), MIN_CHUNK), Partial());
+
+	pool->ParallelFor(group.size(), MIN_CHUNK, [&](size_t chunk, size_t begin, size_t end)
+		{
+			PROFILE_ZONE("Observables chunk");
+
+			Partial& p = partials[chunk];
+
+			for (size_t i = begin; i < end; i++)
+			{
+				auto& t = group[i]->getComponent<T>();
+				Vector2D v = *t.GetVelocity();
+				AddBody(p, t.Mass(), v.x, v.y, t.PotentialEnergy(gravity, floor));
+				p.wallImpulse.Add(t.TakeWallImpulse());
+			}
+		});
+
+	// Chunk order is fixed, so the merged totals do not depend on thread timing
+	for (auto& p : partials)
+		total.Merge(p);
+}
+
+void Observables::Measure(const std::vector<Entity*>& disks, const std::vector<Entity*>& rects,
+	const std::vector<Entity*>& polys, double interval, ObservableSample& sample)
+{
+	PROFILE_ZONE("Observables::Measure");
+
+	total = Partial();
+
+	Reduce<DiskTransformComponent>(disks);
+	Reduce<RectTransformComponent>(rects);
+	Reduce<PolyTransformComponent>(polys);
+
+	sample.bodies = total.bodies;
+	sample.kinetic = total.kinetic.Value();
+	sample.potential = total.potential.Value();
+	sample.momentumX = total.momentumX.Value();
+	sample.momentumY = total.momentumY.Value();
+	sample.wallImpulse = total.wallImpulse.Value();
+	sample.pressure = interval > 0.0 ? sample.wallImpulse / (interval * perimeter) : 0.0;
+	std::copy(total.speedHistogram, total.speedHistogram + ObservableSample::SPEED_BINS, sample.speedHistogram);
+}
+
+ObservableWriter::ObservableWriter()
+{
+	format = csv;
+	stopping = false;
+	dropped = 0;
+}
+
+ObservableWriter::~ObservableWriter()
+{
+	Close();
+}
+
+bool ObservableWriter::Open(std::string path, FORMAT fmt)
+{
+	Close();
+
+	format = fmt;
+	file.open(path, format == binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Observable file %s could not be opened for writing!\n", path.c_str());
+		return false;
+	}
+
+	if (format == csv)
+	{
+		file << "tick,time,bodies,kinetic,potential,total,momentum_x,momentum_y,wall_impulse,pressure";
+		for (int i = 0; i < ObservableSample::SPEED_BINS; i++)
+			file << ",speed_" << i;
+		file << "\n";
+	}
+	else
+	{
+		const char magic[4] = { 'P', 'S', 'O', 'B' };
+		uint32_t header[3] = { 1u, static_cast<uint32_t>(sizeof(ObservableSample)), static_cast<uint32_t>(ObservableSample::SPEED_BINS) };
+		file.write(magic, sizeof(magic));
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	}
+
+	stopping = false;
+	dropped = 0;
+	thread = std::thread(&ObservableWriter::WriterLoop, this);
+	return true;
+}
+
+void ObservableWriter::Close()
+{
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+
+	if (file.is_open())
+		file.close();
+}
+
+bool ObservableWriter::IsOpen()
+{
+	return file.is_open();
+}
+
+unsigned int ObservableWriter::Dropped()
+{
+	return dropped;
+}
+
+void ObservableWriter::Push(const ObservableSample& sample)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (queue.size() >= MAX_QUEUED)
+		{
+			dropped++;
+			return;
+		}
+
+		queue.push_back(sample);
+	}
+	wake.notify_one();
+}
+
+void ObservableWriter::WriterLoop()
+{
+	std::vector<ObservableSample> batch;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !queue.empty(); });
+
+			if (queue.empty() && stopping)
+				break;
+
+			batch.swap(queue);
+		}
+
+		for (auto& s : batch)
+			WriteSample(s);
+
+		batch.clear();
+		file.flush();
+	}
+}
+
+void ObservableWriter::WriteSample(const ObservableSample& s)
+{
+	if (format == binary)
+	{
+		file.write(reinterpret_cast<const char*>(&s), sizeof(s));
+		return;
+	}
+
+	file << s.tick << ',' << s.time << ',' << s.bodies << ',' << s.kinetic << ',' << s.potential << ','
+		<< (s.kinetic + s.potential) << ',' << s.momentumX << ',' << s.momentumY << ',' << s.wallImpulse << ',' << s.pressure;
+
+	for (int i = 0; i < ObservableSample::SPEED_BINS; i++)
+		file << ',' << s.speedHistogram[i];
+
+	file << '\n';
+}
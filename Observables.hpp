@@ -0,0 +1,141 @@
+#pragma once
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ECS.hpp"
+
+// Neumaier's variant of Kahan summation, which also compensates when an addend is larger than
+// the running sum. Keeps energy totals exact to ~1 ulp over millions of bodies.
+struct NeumaierSum
+{
+	double sum = 0.0;
+	double compensation = 0.0;
+
+	void Add(double x)
+	{
+		double t = sum + x;
+
+		if (std::abs(sum) >= std::abs(x))
+			compensation += (sum - t) + x;
+		else
+			compensation += (x - t) + sum;
+
+		sum = t;
+	}
+
+	void Add(const NeumaierSum& k)
+	{
+		Add(k.sum);
+		Add(k.compensation);
+	}
+
+	double Value() const
+	{
+		return sum + compensation;
+	}
+};
+
+struct ObservableSample
+{
+	static const int SPEED_BINS = 32;
+
+	uint32_t tick;
+	uint32_t bodies;
+	double time;
+
+	double kinetic;
+	double potential;
+	double momentumX;
+	double momentumY;
+
+	// Impulse delivered to the arena walls since the last sample, and the 2D pressure it implies
+	double wallImpulse;
+	double pressure;
+
+	uint32_t speedHistogram[SPEED_BINS];
+};
+
+class Observables
+{
+public:
+
+	// Speeds at or above this land in the last histogram bin
+	float maxSpeed = 1000.0f;
+
+	// Arena boundary length, used to turn wall impulse into pressure
+	float perimeter = 1.0f;
+
+	// Downward acceleration the potential energy is measured against
+	float gravity = 0.0f;
+
+	// Height potential energy is measured from, the bottom of the world
+	float floor = 0.0f;
+
+	// Parallel reduction over every body, interval is the simulated time since the last sample
+	void Measure(const std::vector<Entity*>& disks, const std::vector<Entity*>& rects,
+		const std::vector<Entity*>& polys, double interval, ObservableSample& sample);
+
+private:
+
+	struct Partial
+	{
+		NeumaierSum kinetic;
+		NeumaierSum potential;
+		NeumaierSum momentumX;
+		NeumaierSum momentumY;
+		NeumaierSum wallImpulse;
+		uint32_t bodies = 0;
+		uint32_t speedHistogram[ObservableSample::SPEED_BINS] = {};
+
+		void Merge(const Partial& p);
+	};
+
+	template <typename T> void Reduce(const std::vector<Entity*>& group);
+
+	void AddBody(Partial& p, float mass, float vx, float vy, double potential);
+
+	std::vector<Partial> partials;
+	Partial total;
+};
+
+// Streams samples to disk on a background thread so the simulation never waits on I/O
+class ObservableWriter
+{
+public:
+
+	enum FORMAT { csv = 0, binary };
+
+	static const size_t MAX_QUEUED = 4096;
+
+	ObservableWriter();
+	~ObservableWriter();
+
+	bool Open(std::string path, FORMAT format = csv);
+	void Close();
+	bool IsOpen();
+
+	// Copies the sample into the queue, drops it if the writer has fallen MAX_QUEUED behind
+	void Push(const ObservableSample& sample);
+	unsigned int Dropped();
+
+private:
+
+	void WriterLoop();
+	void WriteSample(const ObservableSample& sample);
+
+	std::ofstream file;
+	FORMAT format;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+
+	std::vector<ObservableSample> queue;
+	bool stopping;
+	unsigned int dropped;
+};
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstdio>
+#include "Game.hpp"
+#include "PerfOverlay.hpp"
+
+namespace
+{
+	const int PANEL_X = 8;
+	const int PANEL_Y = 8;
+	const int PANEL_WIDTH = 380;
+	const int PANEL_HEIGHT = 190;
+
+	const int TEXT_SIZE = 12;
+	const int LINE_HEIGHT = 15;
+
+	const int GRAPH_X = PANEL_X + 8;
+	const int GRAPH_BOTTOM = PANEL_Y + PANEL_HEIGHT - 8;
+	const int GRAPH_HEIGHT = 100;
+	const double PIXELS_PER_MS = GRAPH_HEIGHT / 16.67;
+	const double BUDGET_MS = 1000.0 / 120.0;
+
+	const SDL_Color PHASE_COLOURS[PerfOverlay::PHASE_COUNT] =
+	{
+		{ 230, 80, 80, 0xff },		// collision
+		{ 80, 200, 120, 0xff },		// integration
+		{ 80, 140, 230, 0xff },		// render
+		{ 150, 150, 150, 0xff }		// other
+	};
+}
+
+PerfOverlay::PerfOverlay()
+{
+	graphics = nullptr;
+	visible = false;
+
+	for (auto& l : lines)
+		l = nullptr;
+
+	frameStart = 0;
+	for (int p = 0; p < PHASE_COUNT; p++)
+	{
+		phaseStart[p] = 0;
+		phaseTime[p] = 0.0;
+	}
+
+	for (auto& frame : history)
+		for (auto& t : frame)
+			t = 0.0;
+
+	head = count = 0;
+	lastText = 0;
+}
+
+PerfOverlay::~PerfOverlay()
+{
+	graphics = nullptr;
+}
+
+void PerfOverlay::Shutdown()
+{
+	labels.destroyAll();
+	labels.refresh();
+
+	for (auto& l : lines)
+		l = nullptr;
+
+	graphics = nullptr;
+	visible = false;
+}
+
+void PerfOverlay::Toggle()
+{
+	visible = !visible;
+
+	// Labels need the renderer, so build them the first time the overlay is shown
+	if (visible && graphics == nullptr)
+	{
+		graphics = Graphics::GetInstance();
+
+		SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+		for (int i = 0; i < LINE_COUNT; i++)
+		{
+			auto& label(labels.addEntity());
+			lines[i] = &label.addComponent<UILabelComponent>(PANEL_X + 8, PANEL_Y + 6 + i * LINE_HEIGHT, " ", "assets/arcade_font.ttf", TEXT_SIZE, white);
+		}
+	}
+
+	lastText = 0;
+}
+
+bool PerfOverlay::Visible()
+{
+	return visible;
+}
+
+double PerfOverlay::Milliseconds(Uint64 ticks)
+{
+	return 1000.0 * static_cast<double>(ticks) / static_cast<double>(SDL_GetPerformanceFrequency());
+}
+
+void PerfOverlay::BeginFrame()
+{
+	frameStart = SDL_GetPerformanceCounter();
+
+	for (int p = 0; p < PHASE_COUNT; p++)
+		phaseTime[p] = 0.0;
+}
+
+void PerfOverlay::BeginPhase(PHASE phase)
+{
+	phaseStart[phase] = SDL_GetPerformanceCounter();
+}
+
+void PerfOverlay::EndPhase(PHASE phase)
+{
+	phaseTime[phase] += Milliseconds(SDL_GetPerformanceCounter() - phaseStart[phase]);
+}
+
+void PerfOverlay::EndFrame(const FrameCounters& frameCounters)
+{
+	double total = Milliseconds(SDL_GetPerformanceCounter() - frameStart);
+
+	double covered = 0.0;
+	for (int p = 0; p < other; p++)
+		covered += phaseTime[p];
+	phaseTime[other] = std::max(total - covered, 0.0);
+
+	for (int p = 0; p < PHASE_COUNT; p++)
+		history[head][p] = phaseTime[p];
+	history[head][PHASE_COUNT] = total;
+
+	head = (head + 1) % HISTORY;
+	count = std::min(count + 1, HISTORY);
+
+	counters = frameCounters;
+
+	if (visible && SDL_GetTicks() - lastText >= static_cast<Uint64>(TEXT_INTERVAL_MS))
+	{
+		UpdateText();
+		lastText = SDL_GetTicks();
+	}
+}
+
+void PerfOverlay::UpdateText()
+{
+	if (count == 0)
+		return;
+
+	scratch.resize(count);
+	double phaseMean[PHASE_COUNT] = {};
+
+	for (int i = 0; i < count; i++)
+	{
+		scratch[i] = history[i][PHASE_COUNT];
+		for (int p = 0; p < PHASE_COUNT; p++)
+			phaseMean[p] += history[i][p] / count;
+	}
+
+	std::sort(scratch.begin(), scratch.end());
+	double p50 = scratch[(count - 1) / 2];
+	double p99 = scratch[(count - 1) * 99 / 100];
+	double max = scratch.back();
+
+	char text[128];
+
+	snprintf(text, sizeof(text), "FRAME  P50 %.2f  P99 %.2f  MAX %.2f MS  %u STEPS", p50, p99, max, counters.steps);
+	lines[frameLine]->SetText(text);
+
+	snprintf(text, sizeof(text), "COLL %.2f  INTEG %.2f  RENDER %.2f  OTHER %.2f",
+		phaseMean[collision], phaseMean[integration], phaseMean[render], phaseMean[other]);
+	lines[phaseLine]->SetText(text);
+
+	snprintf(text, sizeof(text), "PAIRS  %u CANDIDATE  %u HIT", counters.candidatePairs, counters.narrowphaseHits);
+	lines[pairLine]->SetText(text);
+
+	snprintf(text, sizeof(text), "BODIES  %u ACTIVE  %u SLEEPING  %u DRAWN", counters.activeBodies, counters.sleepingBodies, counters.drawnBodies);
+	lines[bodyLine]->SetText(text);
+
+	snprintf(text, sizeof(text), "DISKS %u  RECTS %u  POLYS %u", counters.disks, counters.rects, counters.polys);
+	lines[groupLine]->SetText(text);
+}
+
+void PerfOverlay::Draw()
+{
+	if (!visible || graphics == nullptr)
+		return;
+
+	SDL_Rect panel = { PANEL_X, PANEL_Y, PANEL_WIDTH, PANEL_HEIGHT };
+	SDL_Color background = { 0, 0, 0, 0xb0 };
+	graphics->DrawRectangle(background, &panel);
+
+	labels.draw();
+
+	// Stacked bar per frame, oldest on the left, one batch of rectangles per phase
+	for (int p = 0; p < PHASE_COUNT; p++)
+	{
+		bars.clear();
+
+		for (int i = 0; i < count; i++)
+		{
+			int frame = (head - count + i + HISTORY) % HISTORY;
+
+			double below = 0.0;
+			for (int q = 0; q < p; q++)
+				below += history[frame][q];
+
+			int y0 = GRAPH_BOTTOM - static_cast<int>(below * PIXELS_PER_MS);
+			int y1 = GRAPH_BOTTOM - static_cast<int>((below + history[frame][p]) * PIXELS_PER_MS);
+			y0 = std::max(y0, GRAPH_BOTTOM - GRAPH_HEIGHT);
+			y1 = std::max(y1, GRAPH_BOTTOM - GRAPH_HEIGHT);
+
+			if (y0 > y1)
+				bars.push_back({ GRAPH_X + i, y1, 1, y0 - y1 });
+		}
+
+		graphics->DrawRectangles(PHASE_COLOURS[p], bars.data(), static_cast<int>(bars.size()));
+	}
+
+	SDL_Color budget = { 0xff, 0xff, 0xff, 0x80 };
+	SDL_Rect budgetLine = { GRAPH_X, GRAPH_BOTTOM - static_cast<int>(BUDGET_MS * PIXELS_PER_MS), HISTORY, 1 };
+	graphics->DrawRectangle(budget, &budgetLine);
+}
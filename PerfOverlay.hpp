@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ECS.hpp"
+#include "Graphics.hpp"
+
+class UILabelComponent;
+
+// Per-frame simulation counters, filled in by the collision and update code
+struct FrameCounters
+{
+	unsigned int candidatePairs = 0;
+	unsigned int narrowphaseHits = 0;
+	unsigned int activeBodies = 0;
+	unsigned int sleepingBodies = 0;
+	unsigned int drawnBodies = 0;
+
+	// Simulation steps taken for the frame, more than one in turbo
+	unsigned int steps = 0;
+
+	unsigned int disks = 0;
+	unsigned int rects = 0;
+	unsigned int polys = 0;
+};
+
+// Frame time distribution and phase breakdown, drawn over the scene when visible
+class PerfOverlay
+{
+public:
+
+	enum PHASE { collision = 0, integration, render, other, PHASE_COUNT };
+
+	static const int HISTORY = 240;
+	static const int TEXT_INTERVAL_MS = 250;
+
+	// Bodies slower than this are reported as sleeping
+	const float SLEEP_SPEED = 5.0f;
+
+	PerfOverlay();
+	~PerfOverlay();
+
+	// Frees the labels, which hold textures, so it must run before the renderer is destroyed
+	void Shutdown();
+
+	void Toggle();
+	bool Visible();
+
+	void BeginFrame();
+	void BeginPhase(PHASE phase);
+	void EndPhase(PHASE phase);
+
+	// Closes the frame, anything not covered by a phase is booked as other
+	void EndFrame(const FrameCounters& frameCounters);
+
+	void Draw();
+
+private:
+
+	enum LINE { frameLine = 0, phaseLine, pairLine, bodyLine, groupLine, LINE_COUNT };
+
+	Graphics* graphics;
+
+	ECSManager labels;
+	UILabelComponent* lines[LINE_COUNT];
+
+	bool visible;
+
+	Uint64 frameStart;
+	Uint64 phaseStart[PHASE_COUNT];
+	double phaseTime[PHASE_COUNT];
+
+	// Milliseconds per phase for the last HISTORY frames, plus the frame total
+	double history[HISTORY][PHASE_COUNT + 1];
+	int head;
+	int count;
+
+	FrameCounters counters;
+	Uint64 lastText;
+
+	std::vector<double> scratch;
+	std::vector<SDL_Rect> bars;
+
+	double Milliseconds(Uint64 ticks);
+	void UpdateText();
+};
@@ -1,42 +1,70 @@
 #pragma once
-#include <vector>
+#include <cassert>
 #include <iostream>
 #include <initializer_list>
 #include "Vector2D.hpp"
+#include "BoundingBox.hpp"
 
+// Convex polygon with vertices stored inline relative to the centre, so copies never allocate
 struct Polygon
 {
+	static const int MAX_VERTICES = 16;
+
 	Vector2D centre;
-	std::vector<Vector2D> vertices;
+	Vector2D vertices[MAX_VERTICES];
+	int count;
 
 	Polygon()
 	{
-		vertices.emplace_back(VEC_ZERO);
+		count = 0;
 	}
 
 	Polygon(Vector2D cent, std::initializer_list<Vector2D> pts)
 	{
 		centre = cent;
-		for (auto p : pts)
+		count = 0;
+
+		for (auto& p : pts)
 		{
-			vertices.emplace_back(p);
+			AddVertex(p);
 		}
-
-		vertices.emplace_back(vertices[0]);
 	}
 
 	Polygon(Vector2D cent, int n, float r)
 	{
 		centre = cent;
+		count = 0;
 
 		Vector2D p(r, 0);
+		n = n < MAX_VERTICES ? n : MAX_VERTICES;
 
 		for (int i = 0; i < n; i++)
 		{
-			vertices.emplace_back(Vector2D::RotateVector(p, i * 2 * PI / n));
+			AddVertex(Vector2D::RotateVector(p, i * 2 * PI / n));
+		}
+	}
+
+	// Extra vertices past MAX_VERTICES are dropped
+	void AddVertex(const Vector2D& v)
+	{
+		if (count < MAX_VERTICES)
+		{
+			vertices[count++] = v;
 		}
+	}
+
+	// Wraps around, so Vertex(i + 1) closes the loop without a duplicated vertex. An empty
+	// polygon, as default constructed, has nothing to wrap around.
+	const Vector2D& Vertex(int i) const
+	{
+		assert(count > 0);
+		return vertices[i % count];
+	}
 
-		vertices.emplace_back(vertices[0]);
+	Vector2D& Vertex(int i)
+	{
+		assert(count > 0);
+		return vertices[i % count];
 	}
 
 	float Area()
@@ -45,8 +73,24 @@ struct Polygon
 		return 1;
 	}
 
-	int Size()
+	int Size() const
+	{
+		return count;
+	}
+
+	BoundingBox Bounds() const
 	{
-		return vertices.size() - 1;
+		BoundingBox box(centre, centre);
+
+		for (int i = 0; i < count; i++)
+		{
+			Vector2D v = centre + vertices[i];
+			box.min.x = v.x < box.min.x ? v.x : box.min.x;
+			box.min.y = v.y < box.min.y ? v.y : box.min.y;
+			box.max.x = v.x > box.max.x ? v.x : box.max.x;
+			box.max.y = v.y > box.max.y ? v.y : box.max.y;
+		}
+
+		return box;
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,178 @@
+#include <cstdio>
+#include <fstream>
+#include "Profiler.hpp"
+
+Profiler* Profiler::instance = nullptr;
+
+#ifdef PHYSICS_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct ZoneEvent
+	{
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> start;
+		std::atomic<uint64_t> end;
+	};
+
+	// Single producer ring, only the owning thread writes and head is published with release
+	struct ThreadRing
+	{
+		int threadID;
+		std::atomic<uint64_t> head;
+		std::unique_ptr<ZoneEvent[]> events;
+
+		explicit ThreadRing(int id) : threadID(id), head(0), events(new ZoneEvent[Profiler::RING_CAPACITY]) {}
+	};
+
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadRing>> registry;
+	thread_local ThreadRing* localRing = nullptr;
+
+	const auto epoch = std::chrono::steady_clock::now();
+
+	uint64_t Now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - epoch).count());
+	}
+
+	ThreadRing* LocalRing()
+	{
+		if (localRing == nullptr)
+		{
+			// Taken once per thread, never on the recording path afterwards
+			std::lock_guard<std::mutex> lock(registryMutex);
+			registry.emplace_back(new ThreadRing(static_cast<int>(registry.size())));
+			localRing = registry.back().get();
+		}
+
+		return localRing;
+	}
+
+	void WriteEscaped(std::ofstream& file, const char* text)
+	{
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				file << '\\';
+			file << *c;
+		}
+	}
+}
+
+ProfileZone::ProfileZone(const char* zoneName)
+{
+	name = zoneName;
+	start = Now();
+}
+
+ProfileZone::~ProfileZone()
+{
+	ThreadRing* ring = LocalRing();
+	uint64_t h = ring->head.load(std::memory_order_relaxed);
+
+	ZoneEvent& e = ring->events[h & (Profiler::RING_CAPACITY - 1)];
+	e.name.store(name, std::memory_order_relaxed);
+	e.start.store(start, std::memory_order_relaxed);
+	e.end.store(Now(), std::memory_order_relaxed);
+
+	ring->head.store(h + 1, std::memory_order_release);
+}
+
+bool Profiler::Enabled()
+{
+	return true;
+}
+
+bool Profiler::ExportChromeTrace(std::string path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Trace file %s could not be opened for writing!\n", path.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+
+	for (auto& ring : registry)
+	{
+		if (!first)
+			file << ',';
+		first = false;
+
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadID
+			<< ",\"args\":{\"name\":\"Thread " << ring->threadID << "\"}}";
+
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		uint64_t begin = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+
+		for (uint64_t i = begin; i < head; i++)
+		{
+			const ZoneEvent& e = ring->events[i & (RING_CAPACITY - 1)];
+			const char* name = e.name.load(std::memory_order_relaxed);
+			uint64_t start = e.start.load(std::memory_order_relaxed);
+			uint64_t end = e.end.load(std::memory_order_relaxed);
+
+			// The owner may be rewriting this slot by now, skip anything it could have touched
+			if (ring->head.load(std::memory_order_acquire) - i >= RING_CAPACITY || name == nullptr)
+				continue;
+
+			file << ",{\"name\":\"";
+			WriteEscaped(file, name);
+			file << "\",\"cat\":\"physics\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadID
+				<< ",\"ts\":" << start / 1000.0 << ",\"dur\":" << (end - start) / 1000.0 << '}';
+		}
+	}
+
+	file << "]}\n";
+	printf("Wrote trace %s\n", path.c_str());
+	return file.good();
+}
+
+#else
+
+bool Profiler::Enabled()
+{
+	return false;
+}
+
+bool Profiler::ExportChromeTrace(std::string path)
+{
+	printf("Profiling is compiled out, define PHYSICS_PROFILE to record %s\n", path.c_str());
+	return false;
+}
+
+#endif
+
+Profiler* Profiler::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new Profiler();
+	}
+
+	return instance;
+}
+
+void Profiler::Release()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+Profiler::Profiler()
+{}
+
+Profiler::~Profiler()
+{}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+
+// Scoped timing zones, compiled in only when PHYSICS_PROFILE is defined.
+// Without it PROFILE_ZONE expands to nothing, so zones can stay in release code.
+#ifdef PHYSICS_PROFILE
+
+#include <cstdint>
+
+class ProfileZone
+{
+public:
+
+	explicit ProfileZone(const char* zoneName);
+	~ProfileZone();
+
+private:
+
+	const char* name;
+	uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+#else
+
+#define PROFILE_ZONE(name)
+
+#endif
+
+class Profiler
+{
+public:
+
+	// Zones per thread kept for export, older ones are overwritten
+	static const unsigned int RING_CAPACITY = 1u << 16;
+
+	static Profiler* GetInstance();
+	static void Release();
+
+	static bool Enabled();
+
+	// Writes every buffered zone as Chrome trace JSON, open with chrome://tracing or ui.perfetto.dev
+	bool ExportChromeTrace(std::string path);
+
+private:
+
+	static Profiler* instance;
+
+	Profiler();
+	~Profiler();
+};
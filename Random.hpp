@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+// PCG32 generator, small enough to snapshot and identical on every platform
+struct Random
+{
+	uint64_t state;
+	uint64_t inc;
+
+	Random(uint64_t seed = 0x853c49e6748fea9bULL)
+	{
+		Seed(seed);
+	}
+
+	void Seed(uint64_t seed, uint64_t sequence = 0xda3e39cb94b95bdbULL)
+	{
+		state = 0u;
+		inc = (sequence << 1u) | 1u;
+		Next();
+		state += seed;
+		Next();
+	}
+
+	uint32_t Next()
+	{
+		uint64_t old = state;
+		state = old * 6364136223846793005ULL + inc;
+		uint32_t xorshifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = static_cast<uint32_t>(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31u));
+	}
+
+	// Uniform integer in [lo, hi)
+	int Range(int lo, int hi)
+	{
+		return lo + static_cast<int>(Next() % static_cast<uint32_t>(hi - lo));
+	}
+
+	// Uniform float in [0, 1)
+	float Float()
+	{
+		return (Next() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float Range(float lo, float hi)
+	{
+		return lo + (hi - lo) * Float();
+	}
+
+	bool operator==(const Random& r) const
+	{
+		return state == r.state && inc == r.inc;
+	}
+
+	bool operator!=(const Random& r) const
+	{
+		return !(*this == r);
+	}
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include "Vector2D.hpp"
+#include "ECS.hpp"
+
+// Segment from origin along a unit direction
+struct Ray
+{
+	Vector2D origin;
+	Vector2D direction;
+	float length;
+
+	Ray()
+	{
+		length = 0.0f;
+	}
+
+	Ray(Vector2D originIn, Vector2D directionIn, float lengthIn)
+	{
+		origin = originIn;
+		direction = directionIn.Normalised();
+		length = lengthIn;
+	}
+
+	static Ray Between(Vector2D from, Vector2D to)
+	{
+		return Ray(from, to - from, (to - from).Norm());
+	}
+
+	Vector2D At(float distance) const
+	{
+		return origin + distance * direction;
+	}
+};
+
+// Nearest hit along a ray. Static colliders have an invalid entity handle and an id from StaticGeometry::ID_BASE up.
+struct RayHit
+{
+	bool hit;
+	uint32_t id;
+	EntityHandle entity;
+
+	Vector2D point;
+
+	// Facing back along the ray, rays starting inside a shape hit at distance 0
+	Vector2D normal;
+	float distance;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <SDL.h>
 #include "Vector2D.hpp"
+#include "BoundingBox.hpp"
 
 // Dynamic floating-point rectangles
 struct Rect
@@ -69,6 +70,11 @@ struct Rect
 		return w * h;
 	}
 
+	BoundingBox Bounds() const
+	{
+		return BoundingBox(Vector2D(x, y), Vector2D(x + w, y + h));
+	}
+
 	Rect operator+(const Rect& R) const
 	{
 		return Rect(this->x - R.w / 2, this->y - R.h / 2, this->w + R.w, this->h + R.h, this->vx, this->vy);
@@ -0,0 +1,391 @@
+#include <iterator>
+#include "Replay.hpp"
+
+namespace
+{
+	const char MAGIC[4] = { 'P', 'S', 'R', 'L' };
+	const uint32_t VERSION = 1;
+
+	const Uint8 FRAME_MOUSE_MOVED = 0x01;
+	const Uint8 FRAME_BUTTONS = 0x02;
+	const Uint8 FRAME_KEYS = 0x04;
+	const Uint8 FRAME_VIEW = 0x08;
+	const Uint8 RECORD_KEYFRAME = 0x80;
+
+	const Uint16 KEY_PRESSED_BIT = 0x8000;
+	const int KEY_MASK_BYTES = SDL_NUM_SCANCODES / 8;
+}
+
+Replay* Replay::instance = nullptr;
+
+Replay* Replay::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new Replay();
+	}
+
+	return instance;
+}
+
+void Replay::Release()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+Replay::Replay()
+{
+	mode = idle;
+	tick = 0;
+	seed = 0;
+	fixedTimeStep = 0.0f;
+	keyframeInterval = DEFAULT_KEYFRAME_INTERVAL;
+	cursor = firstRecord = 0;
+	desyncReported = false;
+	memset(&last, 0, sizeof(last));
+}
+
+Replay::~Replay()
+{
+	Stop();
+}
+
+Replay::MODE Replay::Mode()
+{
+	return mode;
+}
+
+unsigned int Replay::Tick()
+{
+	return tick;
+}
+
+uint64_t Replay::Seed()
+{
+	return seed;
+}
+
+float Replay::FixedTimeStep()
+{
+	return fixedTimeStep;
+}
+
+void Replay::SetKeyframeWriter(std::function<void(std::vector<char>&)> writer)
+{
+	keyframeWriter = writer;
+}
+
+bool Replay::StartRecording(std::string path, uint64_t recordSeed, float fixedStep, unsigned int interval)
+{
+	Stop();
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Replay file %s could not be opened for writing!\n", path.c_str());
+		return false;
+	}
+
+	seed = recordSeed;
+	fixedTimeStep = fixedStep;
+	keyframeInterval = interval > 0 ? interval : DEFAULT_KEYFRAME_INTERVAL;
+
+	file.write(MAGIC, sizeof(MAGIC));
+	Write(VERSION);
+	Write(seed);
+	Write(fixedTimeStep);
+	Write(static_cast<uint32_t>(keyframeInterval));
+
+	memset(&last, 0, sizeof(last));
+	tick = 0;
+	mode = recording;
+	return true;
+}
+
+void Replay::RecordTick(const InputFrame& frame, const Random& rng)
+{
+	if (mode != recording)
+		return;
+
+	if (tick % keyframeInterval == 0)
+	{
+		Write(RECORD_KEYFRAME);
+		Write(static_cast<uint32_t>(tick));
+		Write(rng.state);
+		Write(rng.inc);
+		Write(static_cast<uint32_t>(frame.mouseState));
+		Write(static_cast<int32_t>(frame.mouseX));
+		Write(static_cast<int32_t>(frame.mouseY));
+		Write(frame.viewX);
+		Write(frame.viewY);
+		Write(frame.viewZoom);
+
+		Uint8 mask[KEY_MASK_BYTES] = {};
+		for (int k = 0; k < SDL_NUM_SCANCODES; k++)
+		{
+			if (frame.keys[k])
+				mask[k >> 3] |= static_cast<Uint8>(1u << (k & 7));
+		}
+		file.write(reinterpret_cast<const char*>(mask), sizeof(mask));
+
+		scratch.clear();
+		if (keyframeWriter)
+			keyframeWriter(scratch);
+
+		Write(static_cast<uint32_t>(scratch.size()));
+		if (!scratch.empty())
+			file.write(scratch.data(), scratch.size());
+	}
+	else
+	{
+		Uint8 flags = 0;
+		if (frame.mouseX != last.mouseX || frame.mouseY != last.mouseY) flags |= FRAME_MOUSE_MOVED;
+		if (frame.mouseState != last.mouseState) flags |= FRAME_BUTTONS;
+		if (frame.viewX != last.viewX || frame.viewY != last.viewY || frame.viewZoom != last.viewZoom) flags |= FRAME_VIEW;
+
+		Uint16 changed = 0;
+		for (int k = 0; k < SDL_NUM_SCANCODES; k++)
+		{
+			if ((frame.keys[k] != 0) != (last.keys[k] != 0))
+				changed++;
+		}
+		if (changed > 0) flags |= FRAME_KEYS;
+
+		Write(flags);
+
+		if (flags & FRAME_MOUSE_MOVED)
+		{
+			Write(static_cast<int16_t>(frame.mouseX));
+			Write(static_cast<int16_t>(frame.mouseY));
+		}
+
+		if (flags & FRAME_BUTTONS)
+			Write(static_cast<Uint8>(frame.mouseState));
+
+		if (flags & FRAME_VIEW)
+		{
+			Write(frame.viewX);
+			Write(frame.viewY);
+			Write(frame.viewZoom);
+		}
+
+		if (flags & FRAME_KEYS)
+		{
+			Write(changed);
+			for (int k = 0; k < SDL_NUM_SCANCODES; k++)
+			{
+				if ((frame.keys[k] != 0) != (last.keys[k] != 0))
+					Write(static_cast<Uint16>(k | (frame.keys[k] ? KEY_PRESSED_BIT : 0)));
+			}
+		}
+	}
+
+	last = frame;
+	tick++;
+}
+
+bool Replay::StartPlayback(std::string path)
+{
+	Stop();
+
+	std::ifstream in(path, std::ios::binary);
+	if (!in.is_open())
+	{
+		printf("Replay file %s could not be opened!\n", path.c_str());
+		return false;
+	}
+
+	data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+	cursor = 0;
+	char magic[4];
+	uint32_t version = 0, interval = 0;
+
+	if (!Read(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !Read(version) || version != VERSION
+		|| !Read(seed) || !Read(fixedTimeStep) || !Read(interval))
+	{
+		printf("Replay file %s is not a valid replay log!\n", path.c_str());
+		data.clear();
+		return false;
+	}
+
+	keyframeInterval = interval;
+	firstRecord = cursor;
+
+	// Index the keyframes up front so seeking is a table lookup
+	keyframes.clear();
+	InputFrame frame;
+	memset(&frame, 0, sizeof(frame));
+	Random rng;
+	bool keyframe = false;
+
+	for (unsigned int t = 0; cursor < data.size(); t++)
+	{
+		size_t offset = cursor;
+		if (!ReadRecord(frame, keyframe, rng, &scratch))
+			break;
+
+		if (keyframe)
+			keyframes.push_back({ t, offset, !scratch.empty() });
+	}
+
+	cursor = firstRecord;
+	memset(&last, 0, sizeof(last));
+	tick = 0;
+	desyncReported = false;
+	mode = playing;
+	return true;
+}
+
+bool Replay::ReadRecord(InputFrame& frame, bool& keyframe, Random& rng, std::vector<char>* payload)
+{
+	Uint8 flags;
+	if (!Read(flags))
+		return false;
+
+	keyframe = (flags & RECORD_KEYFRAME) != 0;
+
+	if (keyframe)
+	{
+		uint32_t t, buttons, payloadSize;
+		int32_t x, y;
+		Uint8 mask[KEY_MASK_BYTES];
+
+		if (!Read(t) || !Read(rng.state) || !Read(rng.inc) || !Read(buttons) || !Read(x) || !Read(y)
+			|| !Read(frame.viewX) || !Read(frame.viewY) || !Read(frame.viewZoom) || !Read(mask) || !Read(payloadSize))
+			return false;
+
+		if (cursor + payloadSize > data.size())
+			return false;
+
+		if (payload != nullptr)
+			payload->assign(data.begin() + cursor, data.begin() + cursor + payloadSize);
+		cursor += payloadSize;
+
+		frame.mouseState = buttons;
+		frame.mouseX = x;
+		frame.mouseY = y;
+		for (int k = 0; k < SDL_NUM_SCANCODES; k++)
+			frame.keys[k] = (mask[k >> 3] >> (k & 7)) & 1u;
+
+		return true;
+	}
+
+	if (flags & FRAME_MOUSE_MOVED)
+	{
+		int16_t x, y;
+		if (!Read(x) || !Read(y))
+			return false;
+		frame.mouseX = x;
+		frame.mouseY = y;
+	}
+
+	if (flags & FRAME_BUTTONS)
+	{
+		Uint8 buttons;
+		if (!Read(buttons))
+			return false;
+		frame.mouseState = buttons;
+	}
+
+	if (flags & FRAME_VIEW)
+	{
+		if (!Read(frame.viewX) || !Read(frame.viewY) || !Read(frame.viewZoom))
+			return false;
+	}
+
+	if (flags & FRAME_KEYS)
+	{
+		Uint16 changed;
+		if (!Read(changed))
+			return false;
+
+		for (Uint16 i = 0; i < changed; i++)
+		{
+			Uint16 key;
+			if (!Read(key))
+				return false;
+
+			Uint16 code = key & ~KEY_PRESSED_BIT;
+			if (code < SDL_NUM_SCANCODES)
+				frame.keys[code] = (key & KEY_PRESSED_BIT) ? 1 : 0;
+		}
+	}
+
+	return true;
+}
+
+bool Replay::PlaybackTick(InputFrame& frame, Random& rng)
+{
+	if (mode != playing)
+		return false;
+
+	frame = last;
+
+	Random recorded = rng;
+	bool keyframe = false;
+
+	if (!ReadRecord(frame, keyframe, recorded, nullptr))
+		return false;
+
+	// Keyframes double as a determinism check on the world PRNG
+	if (keyframe && recorded != rng && !desyncReported)
+	{
+		printf("Replay desync detected at tick %u\n", tick);
+		desyncReported = true;
+	}
+
+	last = frame;
+	tick++;
+	return true;
+}
+
+unsigned int Replay::Seek(unsigned int target, Random& rng, std::vector<char>& payload)
+{
+	payload.clear();
+
+	if (mode != playing)
+		return 0;
+
+	const Keyframe* best = nullptr;
+	for (auto& k : keyframes)
+	{
+		if (k.tick > target)
+			break;
+
+		if (k.hasPayload)
+			best = &k;
+	}
+
+	if (best == nullptr)
+	{
+		cursor = firstRecord;
+		memset(&last, 0, sizeof(last));
+		rng.Seed(seed);
+		tick = 0;
+		return 0;
+	}
+
+	// Read the keyframe for its state, then rewind so PlaybackTick consumes it as a normal tick
+	cursor = best->offset;
+	bool keyframe = false;
+	ReadRecord(last, keyframe, rng, &payload);
+
+	cursor = best->offset;
+	tick = best->tick;
+	return tick;
+}
+
+void Replay::Stop()
+{
+	if (file.is_open())
+	{
+		file.close();
+	}
+
+	data.clear();
+	keyframes.clear();
+	mode = idle;
+	tick = 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include "Input.hpp"
+#include "Random.hpp"
+
+// Records the per-tick input stream to a compact binary log and feeds it back.
+// Each tick is stored as a delta against the previous one (a single byte when idle),
+// with a full keyframe every keyframeInterval ticks so playback can seek.
+class Replay
+{
+public:
+
+	enum MODE { idle = 0, recording, playing };
+
+	static const unsigned int DEFAULT_KEYFRAME_INTERVAL = 600;
+
+	static Replay* GetInstance();
+	static void Release();
+
+	bool StartRecording(std::string path, uint64_t seed, float fixedStep, unsigned int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+	bool StartPlayback(std::string path);
+	void Stop();
+
+	MODE Mode();
+	unsigned int Tick();
+	uint64_t Seed();
+	float FixedTimeStep();
+
+	// Extra state stored in every keyframe (e.g. a world snapshot) so seeking can skip ahead
+	void SetKeyframeWriter(std::function<void(std::vector<char>&)> writer);
+
+	void RecordTick(const InputFrame& frame, const Random& rng);
+
+	// Returns false once the log is exhausted
+	bool PlaybackTick(InputFrame& frame, Random& rng);
+
+	// Moves playback to the latest resumable keyframe at or before tick and returns its tick.
+	// The payload is left empty when playback has to restart from the beginning of the log.
+	unsigned int Seek(unsigned int tick, Random& rng, std::vector<char>& payload);
+
+private:
+
+	struct Keyframe
+	{
+		unsigned int tick;
+		size_t offset;
+		bool hasPayload;
+	};
+
+	static Replay* instance;
+
+	Replay();
+	~Replay();
+
+	template <typename T> void Write(const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T> bool Read(T& value)
+	{
+		if (cursor + sizeof(T) > data.size())
+			return false;
+
+		memcpy(&value, &data[cursor], sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	bool ReadRecord(InputFrame& frame, bool& keyframe, Random& rng, std::vector<char>* payload);
+
+	MODE mode;
+	unsigned int tick;
+
+	uint64_t seed;
+	float fixedTimeStep;
+	unsigned int keyframeInterval;
+
+	std::function<void(std::vector<char>&)> keyframeWriter;
+	std::vector<char> scratch;
+
+	std::ofstream file;
+	InputFrame last;
+
+	std::vector<char> data;
+	size_t cursor;
+	size_t firstRecord;
+	std::vector<Keyframe> keyframes;
+	bool desyncReported;
+
+};
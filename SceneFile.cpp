@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "SceneFile.hpp"
+#include "ThreadPool.hpp"
+#include "Profiler.hpp"
+
+namespace
+{
+	const uint32_t DEFAULT_COLOUR = 0xffffffffu;
+
+	void SkipSpace(const char*& p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+			p++;
+	}
+
+	// strtof needs a terminated string, mapped files are not, so numbers are read by hand
+	bool ReadFloat(const char*& p, const char* end, float& out)
+	{
+		SkipSpace(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+
+		for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+		{
+			if (mantissa < 100000000000000000ULL)
+				mantissa = mantissa * 10 + (*p - '0');
+			else
+				exponent++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+			{
+				if (mantissa < 100000000000000000ULL)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+
+		if (digits == 0)
+			return false;
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+'))
+				negativeExponent = *p++ == '-';
+
+			int e = 0;
+			if (p >= end || *p < '0' || *p > '9')
+				return false;
+			for (; p < end && *p >= '0' && *p <= '9'; p++)
+				e = std::min(e * 10 + (*p - '0'), 1000);
+
+			exponent += negativeExponent ? -e : e;
+		}
+
+		// Exact powers of ten cover every number written with a few decimals
+		static const double POWERS[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		double value = static_cast<double>(mantissa);
+		if (exponent >= 0 && exponent <= 22)
+			value *= POWERS[exponent];
+		else if (exponent < 0 && exponent >= -22)
+			value /= POWERS[-exponent];
+		else
+			value *= std::pow(10.0, exponent);
+
+		out = static_cast<float>(negative ? -value : value);
+		return p == end || *p == ' ' || *p == '\t' || *p == ',' || *p == '#';
+	}
+
+	bool ReadUnsigned(const char*& p, const char* end, uint32_t& out)
+	{
+		SkipSpace(p, end);
+
+		int base = 10;
+		if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+		{
+			base = 16;
+			p += 2;
+		}
+
+		uint64_t value = 0;
+		int digits = 0;
+		for (; p < end; p++, digits++)
+		{
+			int d;
+			if (*p >= '0' && *p <= '9')
+				d = *p - '0';
+			else if (base == 16 && *p >= 'a' && *p <= 'f')
+				d = *p - 'a' + 10;
+			else if (base == 16 && *p >= 'A' && *p <= 'F')
+				d = *p - 'A' + 10;
+			else
+				break;
+
+			value = std::min<uint64_t>(value * base + d, 0xffffffffULL);
+		}
+
+		out = static_cast<uint32_t>(value);
+		return digits > 0;
+	}
+
+	bool AtEnd(const char*& p, const char* end)
+	{
+		SkipSpace(p, end);
+		return p == end || *p == '#';
+	}
+
+	// Optional trailing velocity, density and colour, in that order
+	bool ReadOptional(const char*& p, const char* end, float& vx, float& vy, float& density, uint32_t* colour)
+	{
+		vx = vy = 0.0f;
+		density = 1.0f;
+
+		if (AtEnd(p, end))
+			return true;
+		if (!ReadFloat(p, end, vx) || !ReadFloat(p, end, vy))
+			return false;
+
+		if (AtEnd(p, end))
+			return true;
+		if (!ReadFloat(p, end, density))
+			return false;
+
+		if (AtEnd(p, end))
+			return true;
+		return colour != nullptr && ReadUnsigned(p, end, *colour) && AtEnd(p, end);
+	}
+}
+
+bool SceneFile::ParseLine(const char* p, const char* end, SnapshotWriter& out, const char*& error)
+{
+	if (AtEnd(p, end))
+		return true;
+
+	const char* keyword = p;
+	while (p < end && *p != ' ' && *p != '\t')
+		p++;
+	size_t length = p - keyword;
+
+	auto is = [&](const char* word) { return strlen(word) == length && memcmp(word, keyword, length) == 0; };
+
+	float vx, vy, density;
+	error = "bad number";
+
+	if (is("disk"))
+	{
+		float x, y, radius;
+		if (!ReadFloat(p, end, x) || !ReadFloat(p, end, y) || !ReadFloat(p, end, radius)
+			|| !ReadOptional(p, end, vx, vy, density, nullptr))
+			return false;
+
+		out.disks.push_back({ x, y, radius, vx, vy, density, 0.0f });
+		return true;
+	}
+
+	if (is("rect"))
+	{
+		float x, y, w, h;
+		if (!ReadFloat(p, end, x) || !ReadFloat(p, end, y) || !ReadFloat(p, end, w) || !ReadFloat(p, end, h)
+			|| !ReadOptional(p, end, vx, vy, density, nullptr))
+			return false;
+
+		out.rects.push_back({ x, y, w, h, vx, vy, density, 0.0f });
+		return true;
+	}
+
+	if (is("ngon") || is("poly"))
+	{
+		float x, y;
+		uint32_t n;
+		if (!ReadFloat(p, end, x) || !ReadFloat(p, end, y) || !ReadUnsigned(p, end, n))
+			return false;
+
+		if (n < 3 || n > static_cast<uint32_t>(Polygon::MAX_VERTICES))
+		{
+			error = "vertex count out of range";
+			return false;
+		}
+
+		uint32_t first = static_cast<uint32_t>(out.vertices.size());
+
+		if (is("ngon"))
+		{
+			float radius;
+			if (!ReadFloat(p, end, radius))
+				return false;
+
+			Polygon regular(Vector2D(x, y), static_cast<int>(n), radius);
+			for (int i = 0; i < regular.Size(); i++)
+				out.vertices.push_back({ regular.vertices[i].x, regular.vertices[i].y });
+		}
+		else
+		{
+			for (uint32_t i = 0; i < n; i++)
+			{
+				VertexRecord v;
+				if (!ReadFloat(p, end, v.x) || !ReadFloat(p, end, v.y))
+				{
+					out.vertices.resize(first);
+					return false;
+				}
+				out.vertices.push_back(v);
+			}
+		}
+
+		uint32_t colour = DEFAULT_COLOUR;
+		if (!ReadOptional(p, end, vx, vy, density, &colour))
+		{
+			out.vertices.resize(first);
+			return false;
+		}
+
+		out.polys.push_back({ x, y, vx, vy, density, 0.0f, 0.0f, colour, first, n });
+		return true;
+	}
+
+	error = "unknown body type";
+	return false;
+}
+
+bool SceneFile::ParseText(const char* data, size_t size, SnapshotWriter& out)
+{
+	PROFILE_ZONE("SceneFile::ParseText");
+
+	ThreadPool* pool = ThreadPool::GetInstance();
+	std::vector<Chunk> chunks(pool->ChunkCount(size, MIN_CHUNK_BYTES));
+
+	pool->ParallelFor(size, MIN_CHUNK_BYTES, [&](size_t chunk, size_t begin, size_t end)
+		{
+			Chunk& c = chunks[chunk];
+			c.errorOffset = size;
+			c.error = nullptr;
+
+			// A chunk owns the lines that start inside it
+			size_t p = begin;
+			while (p > 0 && p < size && data[p - 1] != '\n')
+				p++;
+
+			while (p < end && p < size)
+			{
+				const char* lineStart = data + p;
+				const char* newline = static_cast<const char*>(memchr(lineStart, '\n', size - p));
+				const char* lineEnd = newline != nullptr ? newline : data + size;
+
+				const char* last = lineEnd;
+				if (last > lineStart && last[-1] == '\r')
+					last--;
+
+				if (!ParseLine(lineStart, last, c.bodies, c.error))
+				{
+					c.errorOffset = p;
+					return;
+				}
+
+				p = static_cast<size_t>(lineEnd - data) + 1;
+			}
+		});
+
+	out.Clear();
+
+	for (const Chunk& c : chunks)
+	{
+		if (c.errorOffset < size)
+		{
+			size_t line = 1 + std::count(data, data + c.errorOffset, '\n');
+			printf("Scene line %zu: %s!\n", line, c.error);
+			return false;
+		}
+
+		out.Append(c.bodies);
+	}
+
+	return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Snapshot.hpp"
+#include "Polygon.hpp"
+
+// Text scene of initial conditions, one body per line, # starts a comment and
+// bracketed values are optional:
+//
+//   disk x y radius [vx vy [density]]
+//   rect x y w h [vx vy [density]]
+//   ngon x y sides radius [vx vy [density [colour]]]
+//   poly x y n x1 y1 ... xn yn [vx vy [density [colour]]]
+//
+// Polygon vertices are relative to x y and colours are 0xRRGGBBAA. Binary scenes are
+// plain snapshots, so either kind can be given wherever a scene is loaded.
+class SceneFile
+{
+public:
+
+	// Bytes per parallel chunk, lines are parsed in chunks and appended in file order
+	static const size_t MIN_CHUNK_BYTES = 1 << 16;
+
+	static bool ParseText(const char* data, size_t size, SnapshotWriter& out);
+
+private:
+
+	struct Chunk
+	{
+		SnapshotWriter bodies;
+
+		// Offset of the first bad line, or size when every line parsed
+		size_t errorOffset;
+		const char* error;
+	};
+
+	static bool ParseLine(const char* p, const char* end, SnapshotWriter& out, const char*& error);
+
+};
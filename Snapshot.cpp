@@ -0,0 +1,323 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include "Snapshot.hpp"
+#include "Polygon.hpp"
+
+namespace
+{
+	const char MAGIC[4] = { 'P', 'S', 'N', 'P' };
+	const uint64_t ALIGNMENT = 16;
+
+	uint64_t Align(uint64_t offset)
+	{
+		return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	template <typename T> void CopyArray(std::vector<char>& out, uint64_t offset, const std::vector<T>& items)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "snapshot records must be plain data");
+
+		if (!items.empty())
+			memcpy(&out[static_cast<size_t>(offset)], items.data(), items.size() * sizeof(T));
+	}
+
+	template <typename T> bool MapArray(const char* data, size_t size, uint64_t offset, uint64_t count, const T*& items)
+	{
+		items = nullptr;
+
+		if (count == 0)
+			return true;
+
+		if (offset % ALIGNMENT != 0 || offset > size || count > (size - offset) / sizeof(T))
+			return false;
+
+		items = reinterpret_cast<const T*>(data + offset);
+		return true;
+	}
+}
+
+void SnapshotWriter::Clear()
+{
+	disks.clear();
+	rects.clear();
+	polys.clear();
+	vertices.clear();
+	chunks.clear();
+	ClearState();
+	hasView = false;
+	flags = 0;
+}
+
+void SnapshotWriter::ClearState()
+{
+	accelerations.clear();
+	ids.clear();
+	nextEntityID = 0;
+	contacts.clear();
+	proxies.clear();
+	order.clear();
+	pairs.clear();
+	engine.clear();
+}
+
+void SnapshotWriter::Append(const SnapshotView& view)
+{
+	ClearState();
+	disks.insert(disks.end(), view.disks, view.disks + view.diskCount);
+	rects.insert(rects.end(), view.rects, view.rects + view.rectCount);
+
+	// Vertex ranges move along with the vertices
+	uint32_t base = static_cast<uint32_t>(vertices.size());
+	vertices.insert(vertices.end(), view.vertices, view.vertices + view.vertexCount);
+
+	for (size_t i = 0; i < view.polyCount; i++)
+	{
+		PolyRecord p = view.polys[i];
+		p.firstVertex += base;
+		polys.push_back(p);
+	}
+}
+
+void SnapshotWriter::Append(const SnapshotWriter& writer)
+{
+	ClearState();
+	disks.insert(disks.end(), writer.disks.begin(), writer.disks.end());
+	rects.insert(rects.end(), writer.rects.begin(), writer.rects.end());
+
+	uint32_t base = static_cast<uint32_t>(vertices.size());
+	vertices.insert(vertices.end(), writer.vertices.begin(), writer.vertices.end());
+
+	for (PolyRecord p : writer.polys)
+	{
+		p.firstVertex += base;
+		polys.push_back(p);
+	}
+}
+
+void SnapshotWriter::Serialise(std::vector<char>& out) const
+{
+	SnapshotHeader header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = SnapshotView::VERSION;
+	header.headerSize = sizeof(SnapshotHeader);
+	header.rngState = rng.state;
+	header.rngInc = rng.inc;
+	header.viewX = viewX;
+	header.viewY = viewY;
+	header.viewZoom = viewZoom;
+	header.hasView = hasView ? 1u : 0u;
+	header.flags = flags;
+
+	uint64_t offset = Align(sizeof(SnapshotHeader));
+
+	header.diskCount = disks.size();
+	header.diskOffset = offset;
+	offset = Align(offset + disks.size() * sizeof(DiskRecord));
+
+	header.rectCount = rects.size();
+	header.rectOffset = offset;
+	offset = Align(offset + rects.size() * sizeof(RectRecord));
+
+	header.polyCount = polys.size();
+	header.polyOffset = offset;
+	offset = Align(offset + polys.size() * sizeof(PolyRecord));
+
+	header.vertexCount = vertices.size();
+	header.vertexOffset = offset;
+	offset = Align(offset + vertices.size() * sizeof(VertexRecord));
+
+	std::vector<ChunkRecord> table(chunks.size());
+	header.chunkCount = chunks.size();
+	header.chunkOffset = offset;
+	offset = Align(offset + chunks.size() * sizeof(ChunkRecord));
+
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		table[i] = { chunks[i].x, chunks[i].y, offset, chunks[i].data.size() };
+		offset = Align(offset + chunks[i].data.size());
+	}
+
+	header.accelerationCount = accelerations.size();
+	header.accelerationOffset = offset;
+	offset = Align(offset + accelerations.size() * sizeof(AccelerationRecord));
+
+	header.idCount = ids.size();
+	header.idOffset = offset;
+	header.nextEntityID = nextEntityID;
+	offset = Align(offset + ids.size() * sizeof(uint32_t));
+
+	header.contactCount = contacts.size();
+	header.contactOffset = offset;
+	offset = Align(offset + contacts.size() * sizeof(ContactRecord));
+
+	header.proxyCount = proxies.size();
+	header.proxyOffset = offset;
+	offset = Align(offset + proxies.size() * sizeof(ProxyRecord));
+
+	header.orderCount = order.size();
+	header.orderOffset = offset;
+	offset = Align(offset + order.size() * sizeof(int32_t));
+
+	header.pairCount = pairs.size();
+	header.pairOffset = offset;
+	offset = Align(offset + pairs.size() * sizeof(PairRecord));
+
+	header.engineSize = engine.size();
+	header.engineOffset = offset;
+	offset = Align(offset + engine.size());
+
+	out.assign(static_cast<size_t>(offset), 0);
+	memcpy(out.data(), &header, sizeof(header));
+
+	CopyArray(out, header.diskOffset, disks);
+	CopyArray(out, header.rectOffset, rects);
+	CopyArray(out, header.polyOffset, polys);
+	CopyArray(out, header.vertexOffset, vertices);
+	CopyArray(out, header.chunkOffset, table);
+	CopyArray(out, header.accelerationOffset, accelerations);
+	CopyArray(out, header.idOffset, ids);
+	CopyArray(out, header.contactOffset, contacts);
+	CopyArray(out, header.proxyOffset, proxies);
+	CopyArray(out, header.orderOffset, order);
+	CopyArray(out, header.pairOffset, pairs);
+	CopyArray(out, header.engineOffset, engine);
+
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		CopyArray(out, table[i].offset, chunks[i].data);
+	}
+}
+
+bool SnapshotWriter::Save(std::string path) const
+{
+	std::vector<char> buffer;
+	Serialise(buffer);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Snapshot file %s could not be opened for writing!\n", path.c_str());
+		return false;
+	}
+
+	file.write(buffer.data(), buffer.size());
+	return file.good();
+}
+
+SnapshotView::SnapshotView()
+{
+	disks = nullptr;
+	rects = nullptr;
+	polys = nullptr;
+	vertices = nullptr;
+	chunks = nullptr;
+	accelerations = nullptr;
+	ids = nullptr;
+	contacts = nullptr;
+	proxies = nullptr;
+	order = nullptr;
+	pairs = nullptr;
+	engine = nullptr;
+	base = nullptr;
+	diskCount = rectCount = polyCount = vertexCount = chunkCount = accelerationCount = 0;
+	idCount = contactCount = proxyCount = orderCount = pairCount = engineSize = 0;
+	nextEntityID = 0;
+	hasView = false;
+	viewX = viewY = 0.0f;
+	viewZoom = 1.0f;
+	flags = 0;
+}
+
+bool SnapshotView::Parse(const char* data, size_t size)
+{
+	if (data == nullptr || size < sizeof(SnapshotHeader))
+		return false;
+
+	SnapshotHeader header;
+	memcpy(&header, data, sizeof(SnapshotHeader));
+
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+		return false;
+
+	if (header.version != VERSION)
+	{
+		printf("Snapshot version %u is not supported (expected %u)\n", header.version, VERSION);
+		return false;
+	}
+
+	if (header.headerSize < sizeof(SnapshotHeader))
+		return false;
+
+	if (!MapArray(data, size, header.diskOffset, header.diskCount, disks)
+		|| !MapArray(data, size, header.rectOffset, header.rectCount, rects)
+		|| !MapArray(data, size, header.polyOffset, header.polyCount, polys)
+		|| !MapArray(data, size, header.vertexOffset, header.vertexCount, vertices)
+		|| !MapArray(data, size, header.chunkOffset, header.chunkCount, chunks)
+		|| !MapArray(data, size, header.accelerationOffset, header.accelerationCount, accelerations)
+		|| !MapArray(data, size, header.idOffset, header.idCount, ids)
+		|| !MapArray(data, size, header.contactOffset, header.contactCount, contacts)
+		|| !MapArray(data, size, header.proxyOffset, header.proxyCount, proxies)
+		|| !MapArray(data, size, header.orderOffset, header.orderCount, order)
+		|| !MapArray(data, size, header.pairOffset, header.pairCount, pairs)
+		|| !MapArray(data, size, header.engineOffset, header.engineSize, engine))
+	{
+		return false;
+	}
+
+	uint64_t bodies = header.diskCount + header.rectCount + header.polyCount;
+	if ((header.accelerationCount != 0 && header.accelerationCount != bodies) || (header.idCount != 0 && header.idCount != bodies))
+		return false;
+
+	// Solver state refers to bodies by id, so it is meaningless without them
+	if (header.idCount == 0 && (header.contactCount != 0 || header.proxyCount != 0 || header.orderCount != 0
+		|| header.pairCount != 0 || header.engineSize != 0))
+		return false;
+
+	for (uint64_t i = 0; i < header.chunkCount; i++)
+	{
+		if (chunks[i].offset % ALIGNMENT != 0 || chunks[i].offset > size || chunks[i].size > size - chunks[i].offset)
+			return false;
+	}
+
+	// Polygon vertex ranges are the only cross references, check them once here. Polygons hold
+	// 3 to MAX_VERTICES, others are rejected rather than silently cut short or left empty.
+	for (uint64_t i = 0; i < header.polyCount; i++)
+	{
+		if (polys[i].vertexCount < 3 || polys[i].vertexCount > static_cast<uint32_t>(Polygon::MAX_VERTICES)
+			|| static_cast<uint64_t>(polys[i].firstVertex) + polys[i].vertexCount > header.vertexCount)
+			return false;
+	}
+
+	diskCount = static_cast<size_t>(header.diskCount);
+	rectCount = static_cast<size_t>(header.rectCount);
+	polyCount = static_cast<size_t>(header.polyCount);
+	vertexCount = static_cast<size_t>(header.vertexCount);
+	chunkCount = static_cast<size_t>(header.chunkCount);
+	accelerationCount = static_cast<size_t>(header.accelerationCount);
+	idCount = static_cast<size_t>(header.idCount);
+	contactCount = static_cast<size_t>(header.contactCount);
+	proxyCount = static_cast<size_t>(header.proxyCount);
+	orderCount = static_cast<size_t>(header.orderCount);
+	pairCount = static_cast<size_t>(header.pairCount);
+	engineSize = static_cast<size_t>(header.engineSize);
+	nextEntityID = header.nextEntityID;
+
+	rng.state = header.rngState;
+	rng.inc = header.rngInc;
+
+	hasView = header.hasView != 0;
+	viewX = header.viewX;
+	viewY = header.viewY;
+	viewZoom = header.viewZoom;
+	flags = header.flags;
+
+	base = data;
+	return true;
+}
+
+const char* SnapshotView::ChunkData(size_t i) const
+{
+	return base + chunks[i].offset;
+}
@@ -0,0 +1,236 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Random.hpp"
+
+// Flat, versioned world snapshot: a fixed header followed by one 16-byte aligned
+// array per body type, so loading is a header check and a few pointer casts.
+
+struct DiskRecord
+{
+	float x, y;
+	float radius;
+	float vx, vy;
+	float density;
+	float theta;
+};
+
+struct RectRecord
+{
+	float x, y;
+	float w, h;
+	float vx, vy;
+	float density;
+	float theta;
+};
+
+struct PolyRecord
+{
+	float x, y;
+	float vx, vy;
+	float density;
+	float theta;
+	float omega;
+	uint32_t colour;
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+};
+
+struct VertexRecord
+{
+	float x, y;
+};
+
+// Acceleration a body ended its last step with, so velocity Verlet resumes without evaluating it
+struct AccelerationRecord
+{
+	float x, y;
+};
+
+// A contact cache entry, so warm starting carries on with the impulses it had
+struct ContactRecord
+{
+	uint64_t key;
+	float normalX, normalY;
+	float pointX, pointY;
+	float depth;
+	float normalImpulse;
+	float tangentImpulse;
+	uint32_t age;
+	uint32_t touching;
+	uint32_t reserved;
+};
+
+// Broadphase proxy from the last step, so scene queries work before the next one
+struct ProxyRecord
+{
+	float minX, minY;
+	float maxX, maxY;
+	uint32_t id;
+	int32_t layer;
+};
+
+// Overlapping pair from the last step, the next step's begin/end diff starts from these
+struct PairRecord
+{
+	uint64_t key;
+	int32_t proxyA;
+	int32_t proxyB;
+};
+
+// Bodies of one stored world chunk, kept as a nested snapshot at a 16-byte aligned offset
+struct ChunkRecord
+{
+	int32_t x, y;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct SnapshotHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t reserved;
+
+	uint64_t rngState;
+	uint64_t rngInc;
+
+	uint64_t diskCount, diskOffset;
+	uint64_t rectCount, rectOffset;
+	uint64_t polyCount, polyOffset;
+	uint64_t vertexCount, vertexOffset;
+	uint64_t chunkCount, chunkOffset;
+
+	float viewX, viewY;
+	float viewZoom;
+	uint32_t hasView;
+
+	// Simulation switches, meaning is up to the game
+	uint32_t flags;
+
+	// Either none or one per body in the order disks, rects, polys
+	uint64_t accelerationCount, accelerationOffset;
+
+	// State a step carries over besides the bodies, keyed by entity id. Ids are either none or
+	// one per body in the order disks, rects, polys, and the rest is only present with them.
+	uint64_t idCount, idOffset;
+	uint32_t nextEntityID;
+	uint32_t reserved2;
+	uint64_t contactCount, contactOffset;
+	uint64_t proxyCount, proxyOffset;
+	uint64_t orderCount, orderOffset;
+	uint64_t pairCount, pairOffset;
+
+	// Event-driven engine, opaque bytes from HardDiskEngine::Serialise
+	uint64_t engineSize, engineOffset;
+};
+
+struct SnapshotChunk
+{
+	int32_t x, y;
+	std::vector<char> data;
+};
+
+class SnapshotView;
+
+class SnapshotWriter
+{
+public:
+
+	std::vector<DiskRecord> disks;
+	std::vector<RectRecord> rects;
+	std::vector<PolyRecord> polys;
+	std::vector<VertexRecord> vertices;
+	std::vector<SnapshotChunk> chunks;
+	std::vector<AccelerationRecord> accelerations;
+	Random rng;
+
+	// Solver state, see SnapshotHeader. Proxies are left out when the bodies they point at are
+	// not queryable, the order and pairs are the broadphase's own.
+	std::vector<uint32_t> ids;
+	uint32_t nextEntityID = 0;
+	std::vector<ContactRecord> contacts;
+	std::vector<ProxyRecord> proxies;
+	std::vector<int32_t> order;
+	std::vector<PairRecord> pairs;
+	std::vector<char> engine;
+
+	// Camera the world was captured with, streaming depends on it
+	bool hasView = false;
+	float viewX = 0.0f, viewY = 0.0f;
+	float viewZoom = 1.0f;
+
+	uint32_t flags = 0;
+
+	void Clear();
+
+	// Adds the bodies of a parsed snapshot or another writer, chunks and view are ignored and
+	// accelerations and solver state dropped, they no longer line up with the bodies
+	void Append(const SnapshotView& view);
+	void Append(const SnapshotWriter& writer);
+
+	void Serialise(std::vector<char>& out) const;
+	bool Save(std::string path) const;
+
+private:
+
+	void ClearState();
+};
+
+// Zero-copy view, the arrays point into the buffer passed to Parse and live as long as it does
+class SnapshotView
+{
+public:
+
+	// Bumped whenever the layout changes, older files are refused rather than converted
+	static const uint32_t VERSION = 1;
+
+	const DiskRecord* disks;
+	const RectRecord* rects;
+	const PolyRecord* polys;
+	const VertexRecord* vertices;
+	const ChunkRecord* chunks;
+	const AccelerationRecord* accelerations;
+	const uint32_t* ids;
+	const ContactRecord* contacts;
+	const ProxyRecord* proxies;
+	const int32_t* order;
+	const PairRecord* pairs;
+	const char* engine;
+
+	size_t diskCount;
+	size_t rectCount;
+	size_t polyCount;
+	size_t vertexCount;
+	size_t chunkCount;
+	size_t accelerationCount;
+	size_t idCount;
+	size_t contactCount;
+	size_t proxyCount;
+	size_t orderCount;
+	size_t pairCount;
+	size_t engineSize;
+
+	uint32_t nextEntityID;
+
+	Random rng;
+
+	bool hasView;
+	float viewX, viewY;
+	float viewZoom;
+
+	uint32_t flags;
+
+	SnapshotView();
+
+	bool Parse(const char* data, size_t size);
+
+	// Bytes of chunk i, valid as long as the parsed buffer
+	const char* ChunkData(size_t i) const;
+
+private:
+
+	const char* base;
+};
@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cmath>
+#include "StaticGeometry.hpp"
+#include "Collision.hpp"
+
+void StaticGeometry::Builder::Add(StaticCollider::SHAPE shape, const Polygon& p)
+{
+	if (p.Size() < 2)
+		return;
+
+	StaticCollider c;
+	c.shape = shape;
+	c.polygon = p;
+	c.bounds = p.Bounds();
+	c.restitution = restitution;
+	c.friction = friction;
+	colliders.push_back(c);
+}
+
+void StaticGeometry::Builder::AddSegment(Vector2D a, Vector2D b)
+{
+	Vector2D centre = 0.5f * (a + b);
+	Add(StaticCollider::segmentShape, Polygon(centre, { a - centre, b - centre }));
+}
+
+void StaticGeometry::Builder::AddBox(const Rect& box)
+{
+	Vector2D half(0.5f * box.w, 0.5f * box.h);
+	Add(StaticCollider::boxShape, Polygon(box.Centre(), { Vector2D(-half.x, -half.y), Vector2D(half.x, -half.y),
+		Vector2D(half.x, half.y), Vector2D(-half.x, half.y) }));
+}
+
+void StaticGeometry::Builder::AddPolygon(const Polygon& p)
+{
+	Add(StaticCollider::polygonShape, p);
+}
+
+void StaticGeometry::Builder::AddArena(const Rect& area, float thickness)
+{
+	AddBox(Rect(area.x - thickness, area.y - thickness, area.w + 2.0f * thickness, thickness));
+	AddBox(Rect(area.x - thickness, area.y + area.h, area.w + 2.0f * thickness, thickness));
+	AddBox(Rect(area.x - thickness, area.y, thickness, area.h));
+	AddBox(Rect(area.x + area.w, area.y, thickness, area.h));
+}
+
+StaticGeometry StaticGeometry::Builder::Build(float cellSize) const
+{
+	StaticGeometry g;
+	g.colliders = colliders;
+
+	if (colliders.empty())
+		return g;
+
+	g.bounds = colliders[0].bounds;
+	for (const auto& c : colliders)
+	{
+		g.bounds.min.x = std::min(g.bounds.min.x, c.bounds.min.x);
+		g.bounds.min.y = std::min(g.bounds.min.y, c.bounds.min.y);
+		g.bounds.max.x = std::max(g.bounds.max.x, c.bounds.max.x);
+		g.bounds.max.y = std::max(g.bounds.max.y, c.bounds.max.y);
+	}
+
+	Vector2D extent = g.bounds.max - g.bounds.min;
+	float area = std::max(extent.x, 1.0f) * std::max(extent.y, 1.0f);
+	g.cellSize = std::max(cellSize, std::sqrt(area / MAX_CELLS));
+
+	g.origin = g.bounds.min;
+	g.columns = std::max(1, static_cast<int>(std::ceil(extent.x / g.cellSize)));
+	g.rows = std::max(1, static_cast<int>(std::ceil(extent.y / g.cellSize)));
+
+	// Counting sort of collider references into cells
+	std::vector<int> counts(g.columns * g.rows + 1, 0);
+	for (const auto& c : colliders)
+	{
+		int x0, y0, x1, y1;
+		g.CellRange(c.bounds, x0, y0, x1, y1);
+		for (int y = y0; y <= y1; y++)
+			for (int x = x0; x <= x1; x++)
+				counts[y * g.columns + x + 1]++;
+	}
+
+	for (size_t i = 1; i < counts.size(); i++)
+		counts[i] += counts[i - 1];
+
+	g.cellStart = counts;
+	g.items.resize(counts.back());
+
+	for (int i = 0; i < static_cast<int>(colliders.size()); i++)
+	{
+		int x0, y0, x1, y1;
+		g.CellRange(colliders[i].bounds, x0, y0, x1, y1);
+		for (int y = y0; y <= y1; y++)
+			for (int x = x0; x <= x1; x++)
+				g.items[counts[y * g.columns + x]++] = i;
+	}
+
+	return g;
+}
+
+StaticGeometry::StaticGeometry()
+{
+	cellSize = DEFAULT_CELL_SIZE;
+	columns = 0;
+	rows = 0;
+}
+
+int StaticGeometry::Count() const
+{
+	return static_cast<int>(colliders.size());
+}
+
+const StaticCollider& StaticGeometry::Collider(int index) const
+{
+	return colliders[index];
+}
+
+const BoundingBox& StaticGeometry::Bounds() const
+{
+	return bounds;
+}
+
+void StaticGeometry::Cell(const Vector2D& p, int& x, int& y) const
+{
+	x = std::min(std::max(static_cast<int>(std::floor((p.x - origin.x) / cellSize)), 0), columns - 1);
+	y = std::min(std::max(static_cast<int>(std::floor((p.y - origin.y) / cellSize)), 0), rows - 1);
+}
+
+void StaticGeometry::CellRange(const BoundingBox& box, int& x0, int& y0, int& x1, int& y1) const
+{
+	Cell(box.min, x0, y0);
+	Cell(box.max, x1, y1);
+}
+
+void StaticGeometry::Query(const BoundingBox& box, std::vector<int>& out) const
+{
+	if (colliders.empty() || !box.Overlaps(bounds))
+		return;
+
+	int x0, y0, x1, y1;
+	CellRange(box, x0, y0, x1, y1);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			int cell = y * columns + x;
+
+			for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+			{
+				const StaticCollider& c = colliders[items[i]];
+				if (!c.bounds.Overlaps(box))
+					continue;
+
+				// Report a collider only from the cell holding the corner of the overlap, so
+				// colliders spanning several cells are not returned twice
+				int cx, cy;
+				Cell(Vector2D(std::max(c.bounds.min.x, box.min.x), std::max(c.bounds.min.y, box.min.y)), cx, cy);
+
+				if (cx == x && cy == y)
+					out.push_back(items[i]);
+			}
+		}
+	}
+}
+
+int StaticGeometry::Raycast(const Ray& ray, float& distance, Vector2D& normal) const
+{
+	if (colliders.empty())
+		return -1;
+
+	// Clip the ray to the grid, nothing outside it can be hit
+	float tStart, tBack;
+	Vector2D ignored;
+	if (!Collision::RayBox(ray, bounds, tStart, ignored))
+		return -1;
+
+	Ray back(ray.At(ray.length), -ray.direction, ray.length);
+	float tEnd = Collision::RayBox(back, bounds, tBack, ignored) ? ray.length - tBack : ray.length;
+
+	int x, y;
+	Cell(ray.At(tStart), x, y);
+
+	// Distance along the ray to the next cell boundary on each axis, and between boundaries
+	int stepX = ray.direction.x > 0.0f ? 1 : -1;
+	int stepY = ray.direction.y > 0.0f ? 1 : -1;
+	float nextX = origin.x + (x + (stepX > 0 ? 1 : 0)) * cellSize;
+	float nextY = origin.y + (y + (stepY > 0 ? 1 : 0)) * cellSize;
+	float tNextX = ray.direction.x != 0.0f ? (nextX - ray.origin.x) / ray.direction.x : INFINITY;
+	float tNextY = ray.direction.y != 0.0f ? (nextY - ray.origin.y) / ray.direction.y : INFINITY;
+	float tDeltaX = ray.direction.x != 0.0f ? cellSize / std::abs(ray.direction.x) : INFINITY;
+	float tDeltaY = ray.direction.y != 0.0f ? cellSize / std::abs(ray.direction.y) : INFINITY;
+
+	int nearest = -1;
+	float nearestDistance = ray.length;
+
+	while (true)
+	{
+		int cell = y * columns + x;
+		for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+		{
+			float t;
+			Vector2D n;
+			int index = items[i];
+
+			// Colliders spanning several cells are tested again, ties keep the lowest index
+			if (Collision::RayPolygon(ray, colliders[index].polygon, t, n)
+				&& (nearest < 0 || t < nearestDistance || (t == nearestDistance && index < nearest)))
+			{
+				nearest = index;
+				nearestDistance = t;
+				normal = n;
+			}
+		}
+
+		// A hit inside this cell cannot be beaten by a later cell
+		float cellExit = std::min(tNextX, tNextY);
+		if (nearest >= 0 && nearestDistance <= cellExit)
+			break;
+
+		if (cellExit > tEnd)
+			break;
+
+		if (tNextX < tNextY)
+		{
+			x += stepX;
+			tNextX += tDeltaX;
+		}
+		else
+		{
+			y += stepY;
+			tNextY += tDeltaY;
+		}
+
+		if (x < 0 || x >= columns || y < 0 || y >= rows)
+			break;
+	}
+
+	distance = nearestDistance;
+	return nearest;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Polygon.hpp"
+#include "Rect.hpp"
+#include "BoundingBox.hpp"
+#include "Ray.hpp"
+
+// Immovable collider. Segments are two vertex polygons and boxes four, so the narrowphase
+// only has to deal with convex polygons.
+struct StaticCollider
+{
+	enum SHAPE { segmentShape = 0, boxShape, polygonShape };
+
+	SHAPE shape;
+	Polygon polygon;
+	BoundingBox bounds;
+
+	float restitution;
+	float friction;
+};
+
+// Static colliders bucketed into a uniform grid. The structure is never modified after
+// Build, so it can be queried from any thread without locking.
+class StaticGeometry
+{
+public:
+
+	// Static collider ids live above every entity id so both can share pair keys
+	static const uint32_t ID_BASE = 0x80000000u;
+
+	static const int DEFAULT_CELL_SIZE = 128;
+
+	// Large worlds get coarser cells rather than an unbounded cell array
+	static const int MAX_CELLS = 1 << 20;
+
+	class Builder
+	{
+	public:
+
+		float restitution = 0.0f;
+		float friction = 0.5f;
+
+		void AddSegment(Vector2D a, Vector2D b);
+		void AddBox(const Rect& box);
+		void AddPolygon(const Polygon& p);
+
+		// Four boxes of the given thickness enclosing the area, so fast bodies cannot slip through
+		void AddArena(const Rect& area, float thickness);
+
+		StaticGeometry Build(float cellSize = DEFAULT_CELL_SIZE) const;
+
+	private:
+
+		void Add(StaticCollider::SHAPE shape, const Polygon& p);
+
+		std::vector<StaticCollider> colliders;
+	};
+
+	StaticGeometry();
+
+	int Count() const;
+	const StaticCollider& Collider(int index) const;
+	const BoundingBox& Bounds() const;
+
+	// Appends the index of every collider whose bounds overlap the box, each exactly once
+	void Query(const BoundingBox& box, std::vector<int>& out) const;
+
+	// Nearest collider along the ray, walking the grid cells it crosses in order. -1 for no hit.
+	int Raycast(const Ray& ray, float& distance, Vector2D& normal) const;
+
+private:
+
+	void Cell(const Vector2D& p, int& x, int& y) const;
+	void CellRange(const BoundingBox& box, int& x0, int& y0, int& x1, int& y1) const;
+
+	std::vector<StaticCollider> colliders;
+	BoundingBox bounds;
+
+	Vector2D origin;
+	float cellSize;
+	int columns;
+	int rows;
+
+	// Collider indices of cell c are items[cellStart[c]] to items[cellStart[c + 1] - 1]
+	std::vector<int> cellStart;
+	std::vector<int> items;
+
+};
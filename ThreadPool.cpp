@@ -0,0 +1,169 @@
+#include <algorithm>
+#include "ThreadPool.hpp"
+
+ThreadPool* ThreadPool::instance = nullptr;
+
+namespace
+{
+	thread_local int threadIndex = 0;
+	thread_local bool insideJob = false;
+}
+
+ThreadPool* ThreadPool::GetInstance()
+{
+	if (instance == nullptr)
+	{
+		instance = new ThreadPool();
+	}
+
+	return instance;
+}
+
+void ThreadPool::Release()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+ThreadPool::ThreadPool()
+{
+	stopping = false;
+	generation = 0;
+	job = nullptr;
+	jobCount = jobChunks = 0;
+	nextChunk = 0;
+	pendingChunks = 0;
+	activeWorkers = 0;
+
+	int hardware = static_cast<int>(std::thread::hardware_concurrency());
+	int nWorkers = std::max(hardware, 1) - 1;
+
+	for (int i = 0; i < nWorkers; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this, i + 1);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (auto& w : workers)
+	{
+		w.join();
+	}
+}
+
+int ThreadPool::ThreadCount()
+{
+	return static_cast<int>(workers.size()) + 1;
+}
+
+int ThreadPool::ThreadIndex()
+{
+	return threadIndex;
+}
+
+size_t ThreadPool::ChunkCount(size_t count, size_t minChunk)
+{
+	if (count == 0)
+		return 0;
+
+	minChunk = std::max<size_t>(minChunk, 1);
+	size_t byCount = (count + minChunk - 1) / minChunk;
+	size_t byThreads = static_cast<size_t>(ThreadCount()) * 4;
+
+	return std::min(byCount, byThreads);
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t minChunk, const ChunkFunction& body)
+{
+	size_t chunks = ChunkCount(count, minChunk);
+	if (chunks == 0)
+		return;
+
+	// Small jobs and nested calls run inline with the same chunk boundaries
+	if (chunks == 1 || workers.empty() || insideJob)
+	{
+		for (size_t c = 0; c < chunks; c++)
+		{
+			body(c, c * count / chunks, (c + 1) * count / chunks);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &body;
+		jobCount = count;
+		jobChunks = chunks;
+		nextChunk = 0;
+		pendingChunks = chunks;
+		generation++;
+	}
+	wake.notify_all();
+
+	RunChunks(body, count, chunks);
+
+	// Workers still inside the loop hold copies of this job, wait for them before it goes away
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return pendingChunks.load() == 0 && activeWorkers == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::RunChunks(const ChunkFunction& body, size_t count, size_t chunks)
+{
+	insideJob = true;
+
+	size_t c;
+	while ((c = nextChunk.fetch_add(1)) < chunks)
+	{
+		body(c, c * count / chunks, (c + 1) * count / chunks);
+		pendingChunks.fetch_sub(1);
+	}
+
+	insideJob = false;
+}
+
+void ThreadPool::WorkerLoop(int index)
+{
+	threadIndex = index;
+	unsigned int seen = 0;
+
+	while (true)
+	{
+		const ChunkFunction* body = nullptr;
+		size_t count = 0, chunks = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+
+			if (stopping)
+				return;
+
+			seen = generation;
+
+			// Woke up after the job finished, nothing to do
+			if (job == nullptr)
+				continue;
+
+			body = job;
+			count = jobCount;
+			chunks = jobChunks;
+			activeWorkers++;
+		}
+
+		RunChunks(*body, count, chunks);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeWorkers--;
+		}
+		done.notify_all();
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for data-parallel loops. The calling thread joins in,
+// and the split into chunks only depends on the item count and the thread count,
+// so per-chunk results combined in chunk order are deterministic.
+class ThreadPool
+{
+public:
+
+	using ChunkFunction = std::function<void(size_t chunk, size_t begin, size_t end)>;
+
+	static ThreadPool* GetInstance();
+	static void Release();
+
+	// Including the calling thread
+	int ThreadCount();
+
+	// Index of the current thread in [0, ThreadCount), 0 for the main thread
+	static int ThreadIndex();
+
+	size_t ChunkCount(size_t count, size_t minChunk);
+
+	// Runs body over [0, count) in ChunkCount(count, minChunk) chunks and blocks until done
+	void ParallelFor(size_t count, size_t minChunk, const ChunkFunction& body);
+
+private:
+
+	static ThreadPool* instance;
+
+	ThreadPool();
+	~ThreadPool();
+
+	void WorkerLoop(int index);
+	void RunChunks(const ChunkFunction& body, size_t count, size_t chunks);
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	bool stopping;
+	unsigned int generation;
+
+	const ChunkFunction* job;
+	size_t jobCount;
+	size_t jobChunks;
+	std::atomic<size_t> nextChunk;
+	std::atomic<size_t> pendingChunks;
+	int activeWorkers;
+
+};
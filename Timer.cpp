@@ -19,10 +19,25 @@ void Timer::Release()
 }
 
 float Timer::DeltaTime()
+{
+	return fixedTimeStep > 0.0f ? fixedTimeStep : deltaTime;
+}
+
+float Timer::ElapsedTime()
 {
 	return deltaTime;
 }
 
+void Timer::SetFixedTimeStep(float dt)
+{
+	fixedTimeStep = dt;
+}
+
+float Timer::FixedTimeStep()
+{
+	return fixedTimeStep;
+}
+
 void Timer::SetTimeScale(float t)
 {
 	timeScale = t;
@@ -39,6 +54,7 @@ Timer::Timer()
 	timeScale = 1.0f;
 	elapsedTicks = 0;
 	deltaTime = 0.0f;
+	fixedTimeStep = 0.0f;
 }
 
 Timer::~Timer()
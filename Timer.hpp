@@ -11,6 +11,13 @@ public:
 	void Reset();
 	float DeltaTime();
 
+	// Wall-clock seconds since Reset, unaffected by the fixed time step
+	float ElapsedTime();
+
+	// A positive step makes DeltaTime constant, used for deterministic record and replay
+	void SetFixedTimeStep(float dt);
+	float FixedTimeStep();
+
 	void SetTimeScale(float t);
 	float TimeScale();
 
@@ -24,6 +31,7 @@ private:
 	unsigned int elapsedTicks;
 	float deltaTime;
 	float timeScale;
+	float fixedTimeStep;
 
 	Timer();
 	~Timer();
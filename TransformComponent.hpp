@@ -1,7 +1,7 @@
 #pragma once
+#include <cmath>
 #include "Components.hpp"
 #include "Vector2D.hpp"
-#include "Timer.hpp"
 #include "Disk.h"
 #include "Rect.hpp"
 
@@ -10,8 +10,6 @@ class PolyTransformComponent : public Component
 private:
 
 	Graphics* graphics;
-	Timer* timer;
-	const float GRAV_ACC = 1.0f;
 
 	SDL_Color colour;
 
@@ -23,47 +21,31 @@ public:
 	float omega;
 	float density;
 	float mass;
+	float wallImpulse;
 
 	PolyTransformComponent() = default;
 
-	PolyTransformComponent(Polygon p, float d)
+	PolyTransformComponent(const Polygon& p, float d, SDL_Color c)
 	{
 		polygon = p;
 		omega = theta = 0.0f;
 		density = d;
 		mass = d * polygon.Area();
-
-		Uint8 r = rand() % 255;
-		Uint8 g = rand() % 255;
-		Uint8 b = rand() % 255;
-		colour = { r,g,b, 0xff };
+		colour = c;
 	}
 
 	~PolyTransformComponent()
 	{
-		timer = nullptr;
 		graphics = nullptr;
 	}
 
 	void init() override
 	{
 		velocity.Zero();
-		timer = Timer::GetInstance();
+		wallImpulse = 0.0f;
 		graphics = Graphics::GetInstance();
 	}
 
-	void EarlyUpdate() override
-	{
-		polygon.centre.x += 0.5f * velocity.x * timer->DeltaTime();
-		polygon.centre.y += 0.5f * velocity.y * timer->DeltaTime();
-	}
-
-	void Update() override
-	{
-		polygon.centre.x += 0.5f * velocity.x * timer->DeltaTime();
-		polygon.centre.y += 0.5f * velocity.y * timer->DeltaTime();
-	}
-
 	void draw() override
 	{
 		int n = polygon.Size();
@@ -71,7 +53,7 @@ public:
 		for (int i = 0; i < n; i++)
 		{
 			graphics->DrawLine(colour, polygon.centre, polygon.centre + polygon.vertices[i]); 
-			graphics->DrawLine(colour, polygon.centre + polygon.vertices[i], polygon.centre + polygon.vertices[i+1]);
+			graphics->DrawLine(colour, polygon.centre + polygon.Vertex(i), polygon.centre + polygon.Vertex(i + 1));
 		}
 
 	}
@@ -86,31 +68,72 @@ public:
 		polygon.centre += disp;
 	}
 
-	float Energy()
+	Vector2D* GetVelocity()
+	{
+		return &velocity;
+	}
+
+	BoundingBox Bounds()
+	{
+		return polygon.Bounds();
+	}
+
+	void SetVelocity(Vector2D vel)
+	{
+		velocity = vel;
+	}
+
+	float KineticEnergy()
 	{
 		return 0.5f * mass * velocity.NormSquared();
 	}
 
+	// Polygons are not affected by gravity
+	float PotentialEnergy(float /*gravity*/, float /*floor*/)
+	{
+		return 0.0f;
+	}
+
+	// Impulse delivered by static geometry, summed until taken by the observables
+	void AddWallImpulse(float impulse)
+	{
+		wallImpulse += impulse;
+	}
+
+	float TakeWallImpulse()
+	{
+		float impulse = wallImpulse;
+		wallImpulse = 0.0f;
+		return impulse;
+	}
+
+	float Energy(float gravity, float floor)
+	{
+		return KineticEnergy() + PotentialEnergy(gravity, floor);
+	}
+
 	float Mass()
 	{
 		return mass;
 	}
 
+	SDL_Color Colour()
+	{
+		return colour;
+	}
+
 };
 
 class DiskTransformComponent : public Component
 {
 private:
 
-	Timer* timer;
-
 	Vector2D velocity;
 	float theta;
 	float omega;
 	float density;
 	float mass;
-
-	const float GRAV_ACC = 1.0f;
+	float wallImpulse;
 
 public:
 
@@ -129,56 +152,10 @@ public:
 		mass = d * disk.Area();
 	}
 
-	~DiskTransformComponent()
-	{
-		timer = nullptr;
-	}
-
 	void init() override
 	{
 		velocity.Zero();
-		timer = Timer::GetInstance();
-	}
-
-	void EarlyUpdate() override
-	{
-		disk.centre.x += 0.5f * velocity.x * timer->DeltaTime();
-		disk.centre.y += 0.5f * velocity.y * timer->DeltaTime();
-	}
-
-	void Update() override
-	{
-		// Gravity
-		velocity.y += GRAV_ACC * mass * timer->DeltaTime();
-
-		disk.centre.x += 0.5f * velocity.x * timer->DeltaTime();
-		disk.centre.y += 0.5f * velocity.y * timer->DeltaTime();
-
-		// Reflect off the screen boundaries
-		if (disk.centre.x - disk.radius < 0)
-		{
-			disk.centre.x = disk.radius;
-			velocity.x = -velocity.x;
-		}
-			
-		if (disk.centre.y - disk.radius < 0)
-		{
-			disk.centre.y = disk.radius;
-			velocity.y = -velocity.y;
-		}
-
-		if (disk.centre.x + disk.radius > 800)
-		{
-			disk.centre.x = 800.0f - disk.radius;
-			velocity.x = -velocity.x;
-		}
-			
-		if (disk.centre.y + disk.radius > 640)
-		{
-			disk.centre.y = 640.0f - disk.radius;
-			velocity.y = -velocity.y;
-		}
-			
+		wallImpulse = 0.0f;
 	}
 
 	void ApplyForce(Vector2D F)
@@ -211,6 +188,11 @@ public:
 		return &velocity;
 	}
 
+	BoundingBox Bounds()
+	{
+		return disk.Bounds();
+	}
+
 	void SetVelocity(Vector2D vel)
 	{
 		velocity.x = vel.x;
@@ -232,9 +214,33 @@ public:
 		return theta;
 	}
 
-	float Energy()
+	float KineticEnergy()
+	{
+		return 0.5f * mass * velocity.NormSquared();
+	}
+
+	// Height above the floor, gravity is the integrator's acceleration
+	float PotentialEnergy(float gravity, float floor)
+	{
+		return gravity * mass * (floor - disk.centre.y);
+	}
+
+	float Energy(float gravity, float floor)
 	{
-		return (0.5f * mass * velocity.NormSquared()) + GRAV_ACC * mass * (640 - disk.centre.y);
+		return KineticEnergy() + PotentialEnergy(gravity, floor);
+	}
+
+	// Impulse delivered by static geometry, summed until taken by the observables
+	void AddWallImpulse(float impulse)
+	{
+		wallImpulse += impulse;
+	}
+
+	float TakeWallImpulse()
+	{
+		float impulse = wallImpulse;
+		wallImpulse = 0.0f;
+		return impulse;
 	}
 
 	float Mass()
@@ -242,21 +248,23 @@ public:
 		return mass;
 	}
 
+	float Density()
+	{
+		return density;
+	}
+
 };
 
 class RectTransformComponent : public Component
 {
 private:
 
-	Timer* timer;
-
 	Vector2D velocity;
 	float theta;
 	float omega;
 	float density;
 	float mass;
-
-	const float GRAV_ACC = 1.0f;
+	float wallImpulse;
 
 public:
 
@@ -277,60 +285,19 @@ public:
 		mass = d * rect.Area();
 	}
 
-	~RectTransformComponent()
-	{
-		timer = nullptr;
-	}
-
 	void init() override
 	{
 		velocity.Zero();
-		timer = Timer::GetInstance();
-	}
-
-	void EarlyUpdate() override
-	{
-		rect.x += 0.5f * velocity.x * timer->DeltaTime();
-		rect.y += 0.5f * velocity.y * timer->DeltaTime();
+		wallImpulse = 0.0f;
 	}
 
+	// Integration happens in Game, this keeps the copies in rect and centre in step
 	void Update() override
 	{
-		// Gravity
-		velocity.y += GRAV_ACC * mass * timer->DeltaTime();
-
-		rect.x += 0.5f * velocity.x * timer->DeltaTime();
-		rect.y += 0.5f * velocity.y * timer->DeltaTime();
 		rect.vx = velocity.x;
 		rect.vy = velocity.y;
 
 		centre = rect.Centre();
-
-		// Reflect off the screen boundaries
-		if (rect.x < 0)
-		{
-			rect.x = 0;
-			velocity.x = -velocity.x;
-		}
-
-		if (rect.y < 0)
-		{
-			rect.y = 0;
-			velocity.y = -velocity.y;
-		}
-
-		if (rect.x + rect.w > 800)
-		{
-			rect.x = 800.0f - rect.w;
-			velocity.x = -velocity.x;
-		}
-
-		if (rect.y + rect.h > 640)
-		{
-			rect.y = 640.0f - rect.h;
-			velocity.y = -velocity.y;
-		}
-
 	}
 
 	void ApplyForce(Vector2D F)
@@ -358,6 +325,7 @@ public:
 	{
 		rect.x += disp.x;
 		rect.y += disp.y;
+		centre = rect.Centre();
 	}
 
 	Vector2D* Centre()
@@ -370,6 +338,11 @@ public:
 		return &velocity;
 	}
 
+	BoundingBox Bounds()
+	{
+		return rect.Bounds();
+	}
+
 	void SetVelocity(Vector2D vel)
 	{
 		velocity.x = rect.vx = vel.x;
@@ -391,9 +364,32 @@ public:
 		return theta;
 	}
 
-	float Energy()
+	float KineticEnergy()
 	{
-		return (0.5f * mass * velocity.NormSquared()) + GRAV_ACC * mass * (640 - rect.Centre().y);
+		return 0.5f * mass * velocity.NormSquared();
+	}
+
+	float PotentialEnergy(float gravity, float floor)
+	{
+		return gravity * mass * (floor - rect.Centre().y);
+	}
+
+	float Energy(float gravity, float floor)
+	{
+		return KineticEnergy() + PotentialEnergy(gravity, floor);
+	}
+
+	// Impulse delivered by static geometry, summed until taken by the observables
+	void AddWallImpulse(float impulse)
+	{
+		wallImpulse += impulse;
+	}
+
+	float TakeWallImpulse()
+	{
+		float impulse = wallImpulse;
+		wallImpulse = 0.0f;
+		return impulse;
 	}
 
 	float Mass()
@@ -401,4 +397,9 @@ public:
 		return mass;
 	}
 
+	float Density()
+	{
+		return density;
+	}
+
 };
\ No newline at end of file
@@ -22,6 +22,9 @@ private:
 	SDL_Texture* texture;
 	int textSize;
 
+	// Text set after construction is not cached in Assets, the label owns that texture
+	bool ownsTexture;
+
 public:
 
 	UILabelComponent(int xpos, int ypos, std::string text, std::string fontPath, int size, SDL_Color& colour)
@@ -38,15 +41,40 @@ public:
 
 		texture = assets->GetText(textString, font, textSize, textColour);
 		SDL_QueryTexture(texture, NULL, NULL, &location.w, &location.h);
+		ownsTexture = false;
 	}
 
 	~UILabelComponent()
 	{
+		if (ownsTexture && texture != nullptr)
+		{
+			SDL_DestroyTexture(texture);
+		}
+
 		graphics = nullptr;
 		assets = nullptr;
 		texture = nullptr;
 	}
 
+	// For text that changes often, e.g. counters, where caching every string would grow forever
+	void SetText(std::string text)
+	{
+		if (text == textString)
+			return;
+
+		if (ownsTexture && texture != nullptr)
+		{
+			SDL_DestroyTexture(texture);
+		}
+
+		textString = text;
+		texture = graphics->LoadText(assets->GetFont(font, textSize), textString, textColour);
+		ownsTexture = true;
+
+		location.w = location.h = 0;
+		SDL_QueryTexture(texture, NULL, NULL, &location.w, &location.h);
+	}
+
 	void draw() override
 	{
 		graphics->DrawTexture(texture, nullptr, &location);
@@ -0,0 +1,159 @@
+#pragma once
+#include <math.h>
+#include "Vector2D.hpp"
+
+// Eight vectors stored as separate x and y lanes. Every operation is a fixed length loop
+// over the lanes, which compilers turn into one or two SIMD instructions per lane array.
+struct alignas(32) Vec2x8
+{
+	static const int WIDTH = 8;
+
+	float x[WIDTH];
+	float y[WIDTH];
+
+	static Vec2x8 Broadcast(const Vector2D& v)
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = v.x;
+			r.y[i] = v.y;
+		}
+		return r;
+	}
+
+	// Gathers from an array of Vector2D, lanes past n are zeroed
+	static Vec2x8 Load(const Vector2D* v, int n = WIDTH)
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = i < n ? v[i].x : 0.0f;
+			r.y[i] = i < n ? v[i].y : 0.0f;
+		}
+		return r;
+	}
+
+	// Loads from separate x and y arrays, as kept by the SoA kernels
+	static Vec2x8 Load(const float* xs, const float* ys)
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = xs[i];
+			r.y[i] = ys[i];
+		}
+		return r;
+	}
+
+	void Store(Vector2D* v, int n = WIDTH) const
+	{
+		for (int i = 0; i < n && i < WIDTH; i++)
+		{
+			v[i].x = x[i];
+			v[i].y = y[i];
+		}
+	}
+
+	void Store(float* xs, float* ys) const
+	{
+		for (int i = 0; i < WIDTH; i++)
+		{
+			xs[i] = x[i];
+			ys[i] = y[i];
+		}
+	}
+
+	Vec2x8 operator+(const Vec2x8& v) const
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = x[i] + v.x[i];
+			r.y[i] = y[i] + v.y[i];
+		}
+		return r;
+	}
+
+	Vec2x8 operator-(const Vec2x8& v) const
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = x[i] - v.x[i];
+			r.y[i] = y[i] - v.y[i];
+		}
+		return r;
+	}
+
+	Vec2x8 operator*(float s) const
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = x[i] * s;
+			r.y[i] = y[i] * s;
+		}
+		return r;
+	}
+
+	// Per lane scale
+	Vec2x8 operator*(const float* s) const
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			r.x[i] = x[i] * s[i];
+			r.y[i] = y[i] * s[i];
+		}
+		return r;
+	}
+
+	// this += v * s, the usual integration step
+	void MulAdd(const Vec2x8& v, float s)
+	{
+		for (int i = 0; i < WIDTH; i++)
+		{
+			x[i] += v.x[i] * s;
+			y[i] += v.y[i] * s;
+		}
+	}
+
+	void Dot(const Vec2x8& v, float* out) const
+	{
+		for (int i = 0; i < WIDTH; i++)
+		{
+			out[i] = x[i] * v.x[i] + y[i] * v.y[i];
+		}
+	}
+
+	void NormSquared(float* out) const
+	{
+		for (int i = 0; i < WIDTH; i++)
+		{
+			out[i] = x[i] * x[i] + y[i] * y[i];
+		}
+	}
+
+	void Norm(float* out) const
+	{
+		for (int i = 0; i < WIDTH; i++)
+		{
+			out[i] = sqrtf(x[i] * x[i] + y[i] * y[i]);
+		}
+	}
+
+	// Zero lanes stay zero
+	Vec2x8 Normalised() const
+	{
+		Vec2x8 r;
+		for (int i = 0; i < WIDTH; i++)
+		{
+			float n = x[i] * x[i] + y[i] * y[i];
+			float inv = n > 0.0f ? 1.0f / sqrtf(n) : 0.0f;
+			r.x[i] = x[i] * inv;
+			r.y[i] = y[i] * inv;
+		}
+		return r;
+	}
+};
@@ -1,138 +1,150 @@
 #pragma once
 #include <iostream>
+#include <type_traits>
 #include <math.h>
 
+#if defined(PHYSICS_FAST_RSQRT) && (defined(_M_X64) || defined(__SSE__))
+#include <xmmintrin.h>
+#define PHYSICS_USE_RSQRT
+#endif
+
 #define PI 3.14159265
 
+// Plain pair of floats, trivially copyable so arrays of it can be memcpy'd and vectorised
 struct Vector2D
 {
 	float x;
 	float y;
 
 	// Default constructor
-	Vector2D()
-	{
-		x = 0.0f;
-		y = 0.0f;
-	}
+	constexpr Vector2D() : x(0.0f), y(0.0f)
+	{}
 	// Full constructor
-	Vector2D(float xIn, float yIn)
-	{
-		x = xIn;
-		y = yIn;
-	}
-	// Copy constructor
-	Vector2D(const Vector2D& v)
-	{
-		x = v.x;
-		y = v.y;
-	}
+	constexpr Vector2D(float xIn, float yIn) : x(xIn), y(yIn)
+	{}
 
-	float Dot(const Vector2D& v) const
+	constexpr float Dot(const Vector2D& v) const
 	{
-		return this->x * v.x + this->y * v.y;
+		return x * v.x + y * v.y;
 	}
 
-	float Cross(const Vector2D& v) const
+	constexpr float Cross(const Vector2D& v) const
 	{
-		return this->x * v.y - this->y * v.x;
+		return x * v.y - y * v.x;
 	}
 
-	Vector2D operator+(const Vector2D& v) const
+	constexpr Vector2D operator+(const Vector2D& v) const
 	{
 		return Vector2D(x + v.x, y + v.y);
 	}
 
-	Vector2D operator-(const Vector2D& v) const
+	constexpr Vector2D operator-(const Vector2D& v) const
 	{
 		return Vector2D(x - v.x, y - v.y);
 	}
 
-	Vector2D operator*(const Vector2D& v) const
+	constexpr Vector2D operator*(const Vector2D& v) const
 	{
 		return Vector2D(x * v.x, y * v.y);
 	}
 
-	Vector2D& operator+=(const Vector2D& v)
+	constexpr Vector2D& operator+=(const Vector2D& v)
 	{
-		this->x += v.x;
-		this->y += v.y;
+		x += v.x;
+		y += v.y;
 		return *this;
 	}
 
-	Vector2D& operator-=(const Vector2D& v)
+	constexpr Vector2D& operator-=(const Vector2D& v)
 	{
-		this->x -= v.x;
-		this->y -= v.y;
+		x -= v.x;
+		y -= v.y;
 		return *this;
 	}
 
-	Vector2D& operator*=(const Vector2D& v)
+	constexpr Vector2D& operator*=(const Vector2D& v)
 	{
-		this->x *= v.x;
-		this->y *= v.y;
+		x *= v.x;
+		y *= v.y;
 		return *this;
 	}
 
-	Vector2D& operator*=(const float& s)
+	constexpr Vector2D& operator*=(const float& s)
 	{
-		this->x *= s;
-		this->y *= s;
+		x *= s;
+		y *= s;
 		return *this;
 	}
 
-	Vector2D& operator/=(const float& s)
+	constexpr Vector2D& operator/=(const float& s)
 	{
-		this->x /= s;
-		this->y /= s;
+		x /= s;
+		y /= s;
 		return *this;
 	}
 
-	void Zero()
+	constexpr void Zero()
 	{
 		x = 0.0f;
 		y = 0.0f;
 	}
 
-	bool IsZero() const
+	constexpr bool IsZero() const
 	{
 		return x == 0.0f && y == 0.0f;
 	}
 
-	float NormSquared()
+	constexpr float NormSquared() const
 	{
 		return x * x + y * y;
 	}
 
-	float Norm()
+	float Norm() const
+	{
+		return sqrtf(x * x + y * y);
+	}
+
+	// 1/sqrt(s), the SSE estimate plus one Newton step is within ~1e-6 relative error
+	static float InvSqrt(float s)
 	{
-		return static_cast<float>(sqrt(x * x + y * y));
+#ifdef PHYSICS_USE_RSQRT
+		float r = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(s)));
+		return r * (1.5f - 0.5f * s * r * r);
+#else
+		return 1.0f / sqrtf(s);
+#endif
 	}
 
 	void Normalise()
 	{
-		float n = Norm();
+		float n = NormSquared();
 		if (n != 0.f)
 		{
-			x = x / n;
-			y = y / n;
+			*this *= InvSqrt(n);
 		}
 	}
 
-	Vector2D Normalised()
+	// Zero vectors stay zero instead of turning into NaN
+	Vector2D Normalised() const
 	{
-		float n = Norm();
-		return Vector2D(x / n, y / n);
+		float n = NormSquared();
+		if (n == 0.0f)
+			return Vector2D();
+
+		float r = InvSqrt(n);
+		return Vector2D(x * r, y * r);
 	}
 
-	Vector2D Orth() const
+	constexpr Vector2D Orth() const
 	{
-		return Vector2D(-this->y, this->x);
+		return Vector2D(-y, x);
 	}
 
-	static Vector2D RotateVector(Vector2D& v, float theta)
+	static Vector2D RotateVector(const Vector2D& v, float theta)
 	{
-		return Vector2D(static_cast<float>(v.x * cos(theta) - v.y * sin(theta)), static_cast<float>(v.x * sin(theta) + v.y * cos(theta)));
+		float c = cosf(theta);
+		float s = sinf(theta);
+		return Vector2D(v.x * c - v.y * s, v.x * s + v.y * c);
 	}
 
 	friend std::ostream& operator<<(std::ostream& stream, const Vector2D& vec)
@@ -141,42 +153,42 @@ struct Vector2D
 		return stream;
 	}
 
-	bool operator==(const Vector2D& v) const
+	constexpr bool operator==(const Vector2D& v) const
 	{
 		return (x == v.x && y == v.y);
 	}
 
-	Vector2D  operator+() const
+	constexpr Vector2D  operator+() const
 	{
 		return { +x, +y };
 	}
-	
-	Vector2D  operator-() const
+
+	constexpr Vector2D  operator-() const
 	{
 		return { -x, -y };
 	}
-
 };
 
+static_assert(std::is_trivially_copyable<Vector2D>::value, "Vector2D must stay memcpy-able");
+static_assert(sizeof(Vector2D) == 2 * sizeof(float), "Vector2D must stay two packed floats");
 
-
-inline Vector2D operator*(const float& s, const Vector2D& v)
+constexpr Vector2D operator*(const float& s, const Vector2D& v)
 {
 	return Vector2D(s * v.x, s * v.y);
 }
 
-inline Vector2D operator*(const Vector2D& v, const float& s)
+constexpr Vector2D operator*(const Vector2D& v, const float& s)
 {
 	return Vector2D(s * v.x, s * v.y);
 }
 
-inline Vector2D operator/(const Vector2D& v, const float& s)
+constexpr Vector2D operator/(const Vector2D& v, const float& s)
 {
 	return Vector2D(v.x / s, v.y / s);
 }
 
-const Vector2D VEC_RIGHT = Vector2D(1.0f, 0.0f);
-const Vector2D VEC_UP = Vector2D(0.0f, -1.0f);
-const Vector2D VEC_LEFT = Vector2D(-1.0f, 0.0f);
-const Vector2D VEC_DOWN = Vector2D(0.0f, 1.0f);
-const Vector2D VEC_ZERO = Vector2D(0.0f, 0.0f);
\ No newline at end of file
+constexpr Vector2D VEC_RIGHT = Vector2D(1.0f, 0.0f);
+constexpr Vector2D VEC_UP = Vector2D(0.0f, -1.0f);
+constexpr Vector2D VEC_LEFT = Vector2D(-1.0f, 0.0f);
+constexpr Vector2D VEC_DOWN = Vector2D(0.0f, 1.0f);
+constexpr Vector2D VEC_ZERO = Vector2D(0.0f, 0.0f);
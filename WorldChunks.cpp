@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include "WorldChunks.hpp"
+
+WorldChunks::WorldChunks()
+{
+	chunkSize = static_cast<float>(DEFAULT_CHUNK_SIZE);
+
+	// Everything is active until a focus is set
+	x0 = y0 = INT_MIN;
+	x1 = y1 = INT_MAX;
+}
+
+void WorldChunks::SetChunkSize(float size)
+{
+	if (size > 0.0f)
+		chunkSize = size;
+}
+
+float WorldChunks::ChunkSize() const
+{
+	return chunkSize;
+}
+
+uint64_t WorldChunks::Key(int x, int y)
+{
+	return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+int WorldChunks::KeyX(uint64_t key)
+{
+	return static_cast<int32_t>(static_cast<uint32_t>(key >> 32));
+}
+
+int WorldChunks::KeyY(uint64_t key)
+{
+	return static_cast<int32_t>(static_cast<uint32_t>(key));
+}
+
+void WorldChunks::ChunkOf(const Vector2D& p, int& x, int& y) const
+{
+	// Clamped so bodies that fly off to infinity still land in some chunk
+	const float limit = 1.0e9f;
+	x = static_cast<int>(std::floor(std::min(std::max(p.x / chunkSize, -limit), limit)));
+	y = static_cast<int>(std::floor(std::min(std::max(p.y / chunkSize, -limit), limit)));
+}
+
+void WorldChunks::SetPinned(int x, int y, bool pin)
+{
+	uint64_t key = Key(x, y);
+	auto it = std::lower_bound(pinned.begin(), pinned.end(), key);
+	bool found = it != pinned.end() && *it == key;
+
+	if (pin && !found)
+		pinned.insert(it, key);
+	else if (!pin && found)
+		pinned.erase(it);
+}
+
+void WorldChunks::ClearPinned()
+{
+	pinned.clear();
+}
+
+void WorldChunks::SetFocus(const BoundingBox& box)
+{
+	ChunkOf(box.min, x0, y0);
+	ChunkOf(box.max, x1, y1);
+}
+
+bool WorldChunks::IsActive(int x, int y) const
+{
+	if (x >= x0 && x <= x1 && y >= y0 && y <= y1)
+		return true;
+
+	return std::binary_search(pinned.begin(), pinned.end(), Key(x, y));
+}
+
+bool WorldChunks::HasStored(int x, int y) const
+{
+	return stored.count(Key(x, y)) != 0;
+}
+
+size_t WorldChunks::StoredCount() const
+{
+	return stored.size();
+}
+
+void WorldChunks::Store(int x, int y, std::vector<char>& data)
+{
+	stored[Key(x, y)].swap(data);
+	data.clear();
+}
+
+bool WorldChunks::Take(int x, int y, std::vector<char>& out)
+{
+	auto it = stored.find(Key(x, y));
+	if (it == stored.end())
+		return false;
+
+	out.swap(it->second);
+	stored.erase(it);
+	return true;
+}
+
+void WorldChunks::Clear()
+{
+	stored.clear();
+}
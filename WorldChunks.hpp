@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Vector2D.hpp"
+#include "BoundingBox.hpp"
+
+// Square chunks of world space. Chunks inside the focus region or pinned are active and
+// simulated, bodies in any other chunk are kept as a serialised buffer until it activates.
+class WorldChunks
+{
+public:
+
+	static const int DEFAULT_CHUNK_SIZE = 1024;
+
+	WorldChunks();
+
+	void SetChunkSize(float size);
+	float ChunkSize() const;
+
+	static uint64_t Key(int x, int y);
+	static int KeyX(uint64_t key);
+	static int KeyY(uint64_t key);
+
+	void ChunkOf(const Vector2D& p, int& x, int& y) const;
+
+	// Pinned chunks stay active wherever the focus is
+	void SetPinned(int x, int y, bool pinned);
+	void ClearPinned();
+
+	// Every chunk touched by the box becomes active, everything else is inactive
+	void SetFocus(const BoundingBox& box);
+	bool IsActive(int x, int y) const;
+
+	// Calls f(x, y) for every active chunk that has a stored buffer
+	template <typename F> void ForEachActiveStored(F f) const;
+
+	// Calls f(x, y, buffer) for every stored chunk
+	template <typename F> void ForEachStored(F f) const;
+
+	bool HasStored(int x, int y) const;
+	size_t StoredCount() const;
+
+	// The buffer is swapped in, leaving data empty
+	void Store(int x, int y, std::vector<char>& data);
+
+	// Moves the buffer out and forgets the chunk, false if nothing was stored
+	bool Take(int x, int y, std::vector<char>& out);
+
+	// Drops all stored chunks, pinning and focus are kept
+	void Clear();
+
+private:
+
+	float chunkSize;
+
+	// Active rectangle in chunk coordinates, inclusive
+	int x0, y0, x1, y1;
+
+	std::vector<uint64_t> pinned;
+	std::unordered_map<uint64_t, std::vector<char>> stored;
+
+};
+
+template <typename F> void WorldChunks::ForEachActiveStored(F f) const
+{
+	if (stored.empty())
+		return;
+
+	// Whichever side is smaller is walked, the focus can be unbounded
+	double focusArea = (static_cast<double>(x1) - x0 + 1.0) * (static_cast<double>(y1) - y0 + 1.0);
+	if (static_cast<double>(stored.size()) < focusArea + pinned.size())
+	{
+		for (const auto& s : stored)
+		{
+			if (IsActive(KeyX(s.first), KeyY(s.first)))
+				f(KeyX(s.first), KeyY(s.first));
+		}
+		return;
+	}
+
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++)
+			if (HasStored(x, y))
+				f(x, y);
+
+	for (uint64_t key : pinned)
+	{
+		int x = KeyX(key);
+		int y = KeyY(key);
+		bool inFocus = x >= x0 && x <= x1 && y >= y0 && y <= y1;
+		if (!inFocus && HasStored(x, y))
+			f(x, y);
+	}
+}
+
+template <typename F> void WorldChunks::ForEachStored(F f) const
+{
+	for (const auto& s : stored)
+	{
+		f(KeyX(s.first), KeyY(s.first), s.second);
+	}
+}
@@ -1,10 +1,92 @@
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 #include "Game.hpp"
 #include "Graphics.hpp"
 
+namespace
+{
+	const char* USAGE = "Usage: %s [--scene <file>] [--snapshot <file>] [--record <file> | --replay <file> [--seek <tick>]] [--fast-forward <seconds>]\n";
+
+	// The whole argument has to be the number, strtoul alone takes "12abc" and wraps "-1"
+	bool ParseTick(const char* text, unsigned int& tick)
+	{
+		if (!isdigit(static_cast<unsigned char>(text[0])))
+			return false;
+
+		char* end = nullptr;
+		unsigned long value = strtoul(text, &end, 10);
+		if (*end != '\0' || value > UINT_MAX)
+			return false;
+
+		tick = static_cast<unsigned int>(value);
+		return true;
+	}
+
+	bool ParseSeconds(const char* text, float& seconds)
+	{
+		char* end = nullptr;
+		seconds = strtof(text, &end);
+		return end != text && *end == '\0' && std::isfinite(seconds) && seconds >= 0.0f;
+	}
+
+	int Usage(const char* program, const std::string& arg, const char* value)
+	{
+		printf("Invalid value %s for %s\n", value, arg.c_str());
+		printf(USAGE, program);
+		return 1;
+	}
+}
+
 int main(int argc, char* argv[])
 {
+	std::string scenePath, snapshotPath, recordPath, replayPath;
+	unsigned int seekTick = 0;
+	float fastForward = 0.0f;
+
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if (arg == "--scene")
+			scenePath = argv[++i];
+		else if (arg == "--snapshot")
+			snapshotPath = argv[++i];
+		else if (arg == "--record")
+			recordPath = argv[++i];
+		else if (arg == "--replay")
+			replayPath = argv[++i];
+		else if (arg == "--seek")
+		{
+			if (!ParseTick(argv[++i], seekTick))
+				return Usage(argv[0], arg, argv[i]);
+		}
+		else if (arg == "--fast-forward")
+		{
+			if (!ParseSeconds(argv[++i], fastForward))
+				return Usage(argv[0], arg, argv[i]);
+		}
+	}
+
 	Game* game = Game::GetInstance();
 
+	if (!scenePath.empty())
+		game->LoadScene(scenePath);
+
+	if (!snapshotPath.empty())
+		game->LoadSnapshot(snapshotPath);
+
+	if (!replayPath.empty())
+		game->StartReplay(replayPath, seekTick);
+	else if (!recordPath.empty())
+		game->StartRecording(recordPath);
+
+	if (fastForward > 0.0f)
+		game->FastForward(fastForward);
+
 	game->Run();
 
 	Game::Release();